@@ -42,6 +42,7 @@
 #include "gtagsop.h"
 #include "rewrite.h"
 #include "strbuf.h"
+#include "strhash.h"
 #include "strlimcpy.h"
 
 #include "convert.h"
@@ -65,15 +66,23 @@ extern int use_color, fflag, gflag, Gflag, iflag, Iflag, Pflag;
 static REWRITE *rewrite;
 static char last_pattern[IDENTLEN];
 static int locked;
-static int (*code_fputs)(const char *s, FILE *op) = fputs;
+static const char *(*code_string)(const char *s);
 
 /**
- * fputs with coloring.
+ * line image without coloring.
  */
-static int
-color_code_fputs(const char *string, FILE *op)
+static const char *
+plain_code_string(const char *string)
+{
+	return string;
+}
+/**
+ * line image with coloring.
+ */
+static const char *
+color_code_string(const char *string)
 {
-	return fputs(rewrite_string(rewrite, string, 0), op);
+	return rewrite_string(rewrite, string, 0);
 }
 /**
  * set_color_method: setup ANSI escape sequence (SGR).
@@ -240,12 +249,64 @@ set_print0(void)
 {
 	newline = '\0';
 }
+/**
+ * Output records are formatted into cv->output, and written out when
+ * it grows larger than OUTPUT_BUFSIZE and at convert_close().
+ */
+#define OUTPUT_BUFSIZE		65536
+static void
+flush_output(CONVERT *cv)
+{
+	if (strbuf_getlen(cv->output) > 0) {
+		fwrite(strbuf_value(cv->output), 1, strbuf_getlen(cv->output), cv->op);
+		strbuf_reset(cv->output);
+	}
+}
+static void
+end_record(CONVERT *cv)
+{
+	strbuf_putc(cv->output, newline);
+	if (strbuf_getlen(cv->output) >= OUTPUT_BUFSIZE)
+		flush_output(cv);
+}
+/**
+ * put_padded: put a string padded with blanks to width (like "%-16s").
+ */
+static void
+put_padded(STRBUF *sb, const char *s, int width)
+{
+	const char *p = s;
+
+	while (*p)
+		p++;
+	strbuf_nputs(sb, s, p - s);
+	strbuf_nputc(sb, ' ', width - (p - s));
+}
+/**
+ * put_number: put a number right-justified in width (like "%4d").
+ */
+static void
+put_number(STRBUF *sb, int n, int width)
+{
+	char num[32];
+	char *p = num + sizeof(num);
+	unsigned int u = (n < 0) ? -(unsigned int)n : (unsigned int)n;
+
+	do {
+		*--p = u % 10 + '0';
+		u /= 10;
+	} while (u);
+	if (n < 0)
+		*--p = '-';
+	strbuf_nputc(sb, ' ', width - (num + sizeof(num) - p));
+	strbuf_nputs(sb, p, num + sizeof(num) - p);
+}
 /**
  * Path filter for the output of global(1).
  * The path name starts with "./" which is the project root directory.
  */
 static const char *
-convert_pathname(CONVERT *cv, const char *path)
+make_pathname(CONVERT *cv, const char *path)
 {
 	static char buf[MAXPATHLEN];
 	const char *a, *b;
@@ -343,6 +404,247 @@ convert_pathname(CONVERT *cv, const char *path)
 	}
 	return (const char *)path;
 }
+/**
+ * convert_pathname: make_pathname() with memoization.
+ *
+ * Since the records of a file usually appear together and the result
+ * depends only on the path name, each path is converted only once for
+ * the lifetime of a CONVERT. The colored path (--color with -P) depends
+ * on the current pattern, so it is not memoized.
+ */
+static const char *
+convert_pathname(CONVERT *cv, const char *path)
+{
+	struct sh_entry *entry;
+
+	if (use_color && Pflag)
+		return make_pathname(cv, path);
+	entry = strhash_assign(cv->path_cache, path, 1);
+	if (entry->value == NULL)
+		entry->value = strhash_strdup(cv->path_cache, make_pathname(cv, path), 0);
+	return (const char *)entry->value;
+}
+/**
+ * Machine-readable formats (FORMAT_JSON, FORMAT_BINARY)
+ *
+ * See libutil/format.h for the layout.
+ */
+#define JSON_HEADER	"{\"format\":\"global-result\",\"version\":1}"
+#define BINARY_MAGIC	"GRES"
+#define BINARY_VERSION	1
+/**
+ * utf8_length: length of the well-formed UTF-8 sequence at the head.
+ *
+ *	@param[in]	p	string (*p >= 0x80)
+ *	@return		2-4, 0: ill-formed
+ */
+static int
+utf8_length(const unsigned char *p)
+{
+	unsigned char min = 0x80, max = 0xbf;
+	int len, i;
+
+	if (*p >= 0xc2 && *p <= 0xdf)
+		len = 2;
+	else if (*p >= 0xe0 && *p <= 0xef)
+		len = 3;
+	else if (*p >= 0xf0 && *p <= 0xf4)
+		len = 4;
+	else
+		return 0;
+	/* reject overlong forms, surrogates and code points over U+10FFFF */
+	if (*p == 0xe0)
+		min = 0xa0;
+	else if (*p == 0xed)
+		max = 0x9f;
+	else if (*p == 0xf0)
+		min = 0x90;
+	else if (*p == 0xf4)
+		max = 0x8f;
+	if (p[1] < min || p[1] > max)
+		return 0;
+	for (i = 2; i < len; i++)
+		if (p[i] < 0x80 || p[i] > 0xbf)
+			return 0;
+	return len;
+}
+/**
+ * put_json_string: put a string as a JSON string literal.
+ *
+ * Well-formed UTF-8 sequences are put as is. Other bytes of 0x80 or over
+ * are taken as Latin-1 and escaped (\u0080-\u00ff), so that the output
+ * is always valid JSON.
+ */
+static void
+put_json_string(STRBUF *sb, const char *s)
+{
+	static const char hex[] = "0123456789abcdef";
+	const unsigned char *p = (const unsigned char *)s;
+	int len;
+
+	strbuf_putc(sb, '"');
+	for (; *p; p++) {
+		switch (*p) {
+		case '"':
+		case '\\':
+			strbuf_putc(sb, '\\');
+			strbuf_putc(sb, *p);
+			break;
+		case '\n':
+			strbuf_puts(sb, "\\n");
+			break;
+		case '\r':
+			strbuf_puts(sb, "\\r");
+			break;
+		case '\t':
+			strbuf_puts(sb, "\\t");
+			break;
+		default:
+			if (*p < 0x20 || (*p >= 0x80 && (len = utf8_length(p)) == 0)) {
+				strbuf_puts(sb, "\\u00");
+				strbuf_putc(sb, hex[*p >> 4]);
+				strbuf_putc(sb, hex[*p & 0xf]);
+			} else if (*p >= 0x80) {
+				strbuf_nputs(sb, (const char *)p, len);
+				p += len - 1;
+			} else
+				strbuf_putc(sb, *p);
+			break;
+		}
+	}
+	strbuf_putc(sb, '"');
+}
+/**
+ * put_uint32: put a 32-bit unsigned integer in network byte order.
+ */
+static void
+put_uint32(STRBUF *sb, unsigned long n)
+{
+	strbuf_putc(sb, (n >> 24) & 0xff);
+	strbuf_putc(sb, (n >> 16) & 0xff);
+	strbuf_putc(sb, (n >> 8) & 0xff);
+	strbuf_putc(sb, n & 0xff);
+}
+/**
+ * put_binary_string: put a length-prefixed string.
+ */
+static void
+put_binary_string(STRBUF *sb, const char *s)
+{
+	int len = strlen(s);
+
+	put_uint32(sb, len);
+	strbuf_nputs(sb, s, len);
+}
+/**
+ * convert_put_header: put the header of machine-readable formats.
+ *
+ *	@param[in]	format	tag record format
+ *	@param[in]	op	output file
+ *
+ * The header and the trailer are put once for an invocation of global(1),
+ * around the records of all the trees searched.
+ */
+void
+convert_put_header(int format, FILE *op)
+{
+	STATIC_STRBUF(sb);
+
+	strbuf_clear(sb);
+	switch (format) {
+	case FORMAT_JSON:
+		strbuf_puts(sb, JSON_HEADER);
+		strbuf_putc(sb, '\n');
+		break;
+	case FORMAT_BINARY:
+		strbuf_puts(sb, BINARY_MAGIC);
+		put_uint32(sb, BINARY_VERSION);
+		break;
+	default:
+		return;
+	}
+	fwrite(strbuf_value(sb), 1, strbuf_getlen(sb), op);
+}
+/**
+ * convert_put_trailer: put the number of records of machine-readable formats.
+ *
+ *	@param[in]	format	tag record format
+ *	@param[in]	op	output file
+ *	@param[in]	count	number of records
+ */
+void
+convert_put_trailer(int format, FILE *op, int count)
+{
+	STATIC_STRBUF(sb);
+
+	strbuf_clear(sb);
+	switch (format) {
+	case FORMAT_JSON:
+		strbuf_puts(sb, "{\"count\":");
+		put_number(sb, count, 0);
+		strbuf_puts(sb, "}\n");
+		break;
+	case FORMAT_BINARY:
+		put_uint32(sb, 0);
+		put_uint32(sb, count);
+		break;
+	default:
+		return;
+	}
+	fwrite(strbuf_value(sb), 1, strbuf_getlen(sb), op);
+}
+/**
+ * put_record: put a tag record in machine-readable formats.
+ *
+ * The fields are written directly without making a text record.
+ */
+static void
+put_record(CONVERT *cv, const char *tag, const char *path, int lineno, const char *rest, const char *fid)
+{
+	STRBUF *sb = cv->output;
+
+	if (fid == NULL) {
+		fid = gpath_path2fid(path, NULL);
+		if (fid == NULL)
+			die("convert_put_using: unknown file. '%s'", path);
+	}
+	path = convert_pathname(cv, path);
+	if (cv->format == FORMAT_JSON) {
+		strbuf_puts(sb, "{\"root\":");
+		put_json_string(sb, cv->root);
+		strbuf_puts(sb, ",\"fid\":");
+		strbuf_puts(sb, fid);
+		strbuf_puts(sb, ",\"path\":");
+		put_json_string(sb, path);
+		strbuf_puts(sb, ",\"line\":");
+		put_number(sb, lineno, 0);
+		strbuf_puts(sb, ",\"tag\":");
+		put_json_string(sb, tag);
+		strbuf_puts(sb, ",\"image\":");
+		put_json_string(sb, rest);
+		strbuf_puts(sb, "}\n");
+	} else {
+		int start = strbuf_getlen(sb);
+		int length;
+		unsigned char *p;
+
+		put_uint32(sb, 0);		/* length: filled later */
+		put_uint32(sb, strtoul(fid, NULL, 10));
+		put_uint32(sb, lineno);
+		put_binary_string(sb, cv->root);
+		put_binary_string(sb, path);
+		put_binary_string(sb, tag);
+		put_binary_string(sb, rest);
+		length = strbuf_getlen(sb) - start - 4;
+		p = (unsigned char *)strbuf_value(sb) + start;
+		*p++ = (length >> 24) & 0xff;
+		*p++ = (length >> 16) & 0xff;
+		*p++ = (length >> 8) & 0xff;
+		*p = length & 0xff;
+	}
+	if (strbuf_getlen(sb) >= OUTPUT_BUFSIZE)
+		flush_output(cv);
+}
 /**
  * convert_open: open convert filter
  *
@@ -365,6 +667,7 @@ convert_open(int type, int format, const char *root, const char *cwd, const char
 	strbuf_puts(cv->abspath, root);
 	strbuf_unputc(cv->abspath, '/');
 	cv->start_point = strbuf_getlen(cv->abspath);
+	strlimcpy(cv->root, cv->start_point > 0 ? strbuf_value(cv->abspath) : "/", sizeof(cv->root));
 	/*
 	 * copy elements.
 	 */
@@ -375,6 +678,8 @@ convert_open(int type, int format, const char *root, const char *cwd, const char
 	cv->format = format;
 	cv->op = op;
 	cv->db = db;
+	cv->path_cache = strhash_open(256);
+	cv->output = strbuf_open(OUTPUT_BUFSIZE + MAXBUFLEN);
 	/*
 	 * open GPATH.
 	 */
@@ -383,11 +688,11 @@ convert_open(int type, int format, const char *root, const char *cwd, const char
 	/*
 	 * setup coloring.
 	 */
-	code_fputs = fputs;
+	code_string = plain_code_string;
 	if (use_color) {
 		set_color_method();
 		if (!Pflag)
-			code_fputs = color_code_fputs;
+			code_string = color_code_string;
 	}
 	return cv;
 }
@@ -406,6 +711,7 @@ convert_put(CONVERT *cv, const char *ctags_x)
 	int tagnextc = 0;
 	char *tag = NULL, *lineno = NULL, *path, *rest = NULL;
 	const char *fid = NULL;
+	STRBUF *sb;
 
 	if (cv->format == FORMAT_PATH)
 		die("convert_put: internal error.");	/* Use convert_put_path() */
@@ -460,67 +766,68 @@ convert_put(CONVERT *cv, const char *ctags_x)
 	 * The path name has already been encoded.
 	 */
 	path = decode_path(path);
+	sb = cv->output;
 	switch (cv->format) {
 	case FORMAT_CTAGS:
-		fputs(tag, cv->op);
-		fputc('\t', cv->op);
-		fputs(convert_pathname(cv, path), cv->op);
-		fputc('\t', cv->op);
-		fputs(lineno, cv->op);
+		strbuf_puts(sb, tag);
+		strbuf_putc(sb, '\t');
+		strbuf_puts(sb, convert_pathname(cv, path));
+		strbuf_putc(sb, '\t');
+		strbuf_puts(sb, lineno);
 		break;
 	case FORMAT_CTAGS_XID:
 		fid = gpath_path2fid(path, NULL);
 		if (fid == NULL)
 			die("convert_put: unknown file. '%s'", path);
-		fputs(fid, cv->op);
-		fputc(' ', cv->op);
+		strbuf_puts(sb, fid);
+		strbuf_putc(sb, ' ');
 		/* PASS THROUGH */
 	case FORMAT_CTAGS_X:
 		/*
 		 * print until path name.
 		 */
 		*tagnextp = tagnextc;
-		fputs(ctags_x, cv->op);
-		fputc(' ', cv->op);
+		strbuf_puts(sb, ctags_x);
+		strbuf_putc(sb, ' ');
 		/*
 		 * print path name and the rest.
 		 */
-		fputs(convert_pathname(cv, path), cv->op);
-		fputc(' ', cv->op);
-		fputs(rest, cv->op);
+		strbuf_puts(sb, convert_pathname(cv, path));
+		strbuf_putc(sb, ' ');
+		strbuf_puts(sb, rest);
 		break;
 	case FORMAT_CTAGS_MOD:
-		fputs(convert_pathname(cv, path), cv->op);
-		fputc('\t', cv->op);
-		fputs(lineno, cv->op);
-		fputc('\t', cv->op);
-		fputs(rest, cv->op);
+		strbuf_puts(sb, convert_pathname(cv, path));
+		strbuf_putc(sb, '\t');
+		strbuf_puts(sb, lineno);
+		strbuf_putc(sb, '\t');
+		strbuf_puts(sb, rest);
 		break;
 	case FORMAT_GREP:
-		fputs(convert_pathname(cv, path), cv->op);
-		fputc(':', cv->op);
-		fputs(lineno, cv->op);
-		fputc(':', cv->op);
-		fputs(rest, cv->op);
+		strbuf_puts(sb, convert_pathname(cv, path));
+		strbuf_putc(sb, ':');
+		strbuf_puts(sb, lineno);
+		strbuf_putc(sb, ':');
+		strbuf_puts(sb, rest);
 		break;
 	case FORMAT_CSCOPE:
-		fputs(convert_pathname(cv, path), cv->op);
-		fputc(' ', cv->op);
-		fputs(tag, cv->op);
-		fputc(' ', cv->op);
-		fputs(lineno, cv->op);
-		fputc(' ', cv->op);
+		strbuf_puts(sb, convert_pathname(cv, path));
+		strbuf_putc(sb, ' ');
+		strbuf_puts(sb, tag);
+		strbuf_putc(sb, ' ');
+		strbuf_puts(sb, lineno);
+		strbuf_putc(sb, ' ');
 		for (; *rest && isspace(*rest); rest++)
 			;
 		if (*rest)
-			fputs(rest, cv->op);
+			strbuf_puts(sb, rest);
 		else
-			fputs("<unknown>", cv->op);
+			strbuf_puts(sb, "<unknown>");
 		break;
 	default:
 		die("unknown format type.");
 	}
-	(void)fputc(newline, cv->op);
+	end_record(cv);
 }
 /**
  * convert_put_path: convert path into relative or absolute and print.
@@ -536,8 +843,9 @@ convert_put_path(CONVERT *cv, const char *pattern, const char *path)
 		set_color_tag(pattern);
 	if (cv->format != FORMAT_PATH)
 		die("convert_put_path: internal error.");
-	fputs(convert_pathname(cv, path), cv->op);
-	(void)fputc(newline, cv->op);
+	/* each path appears only once; memoization is useless */
+	strbuf_puts(cv->output, make_pathname(cv, path));
+	end_record(cv);
 }
 /**
  * convert_put_using: convert path into relative or absolute and print.
@@ -552,22 +860,29 @@ convert_put_path(CONVERT *cv, const char *pattern, const char *path)
 void
 convert_put_using(CONVERT *cv, const char *tag, const char *path, int lineno, const char *rest, const char *fid)
 {
+	STRBUF *sb;
+
 	if (rest == NULL)
 		rest = "";	/* for safety */
 	if (use_color && !locked)
 		set_color_tag(tag);
 	if (cv->tag_for_display)
 		tag = cv->tag_for_display;
+	sb = cv->output;
 	switch (cv->format) {
+	case FORMAT_JSON:
+	case FORMAT_BINARY:
+		put_record(cv, tag, path, lineno, rest, fid);
+		return;
 	case FORMAT_PATH:
-		fputs(convert_pathname(cv, path), cv->op);
+		strbuf_puts(sb, convert_pathname(cv, path));
 		break;
 	case FORMAT_CTAGS:
-		fputs(tag, cv->op);
-		fputc('\t', cv->op);
-		fputs(convert_pathname(cv, path), cv->op);
-		fputc('\t', cv->op);
-		fprintf(cv->op, "%d", lineno);
+		strbuf_puts(sb, tag);
+		strbuf_putc(sb, '\t');
+		strbuf_puts(sb, convert_pathname(cv, path));
+		strbuf_putc(sb, '\t');
+		put_number(sb, lineno, 0);
 		break;
 	case FORMAT_CTAGS_XID:
 		if (fid == NULL) {
@@ -575,50 +890,58 @@ convert_put_using(CONVERT *cv, const char *tag, const char *path, int lineno, co
 			if (fid == NULL)
 				die("convert_put_using: unknown file. '%s'", path);
 		}
-		fputs(fid, cv->op);
-		fputc(' ', cv->op);
+		strbuf_puts(sb, fid);
+		strbuf_putc(sb, ' ');
 		/* PASS THROUGH */
 	case FORMAT_CTAGS_X:
-		fprintf(cv->op, "%-16s %4d %-16s ",
-			tag, lineno, convert_pathname(cv, path));
-		code_fputs(rest, cv->op);
+		/* same as "%-16s %4d %-16s " */
+		put_padded(sb, tag, 16);
+		strbuf_putc(sb, ' ');
+		put_number(sb, lineno, 4);
+		strbuf_putc(sb, ' ');
+		put_padded(sb, convert_pathname(cv, path), 16);
+		strbuf_putc(sb, ' ');
+		strbuf_puts(sb, code_string(rest));
 		break;
 	case FORMAT_CTAGS_MOD:
-		fputs(convert_pathname(cv, path), cv->op);
-		fputc('\t', cv->op);
-		fprintf(cv->op, "%d", lineno);
-		fputc('\t', cv->op);
-		code_fputs(rest, cv->op);
+		strbuf_puts(sb, convert_pathname(cv, path));
+		strbuf_putc(sb, '\t');
+		put_number(sb, lineno, 0);
+		strbuf_putc(sb, '\t');
+		strbuf_puts(sb, code_string(rest));
 		break;
 	case FORMAT_GREP:
-		fputs(convert_pathname(cv, path), cv->op);
-		fputc(':', cv->op);
-		fprintf(cv->op, "%d", lineno);
-		fputc(':', cv->op);
-		code_fputs(rest, cv->op);
+		strbuf_puts(sb, convert_pathname(cv, path));
+		strbuf_putc(sb, ':');
+		put_number(sb, lineno, 0);
+		strbuf_putc(sb, ':');
+		strbuf_puts(sb, code_string(rest));
 		break;
 	case FORMAT_CSCOPE:
-		fputs(convert_pathname(cv, path), cv->op);
-		fputc(' ', cv->op);
-		fputs(tag, cv->op);
-		fputc(' ', cv->op);
-		fprintf(cv->op, "%d", lineno);
-		fputc(' ', cv->op);
+		strbuf_puts(sb, convert_pathname(cv, path));
+		strbuf_putc(sb, ' ');
+		strbuf_puts(sb, tag);
+		strbuf_putc(sb, ' ');
+		put_number(sb, lineno, 0);
+		strbuf_putc(sb, ' ');
 		for (; *rest && isspace(*rest); rest++)
 			;
 		if (*rest)
-			code_fputs(rest, cv->op);
+			strbuf_puts(sb, code_string(rest));
 		else
-			fputs("<unknown>", cv->op);
+			strbuf_puts(sb, "<unknown>");
 		break;
 	default:
 		die("unknown format type.");
 	}
-	(void)fputc(newline, cv->op);
+	end_record(cv);
 }
 void
 convert_close(CONVERT *cv)
 {
+	flush_output(cv);
+	strbuf_close(cv->output);
+	strhash_close(cv->path_cache);
 	strbuf_close(cv->abspath);
 	gpath_close();
 	free(cv);
@@ -22,6 +22,7 @@
 #include <stdio.h>
 #include "gparam.h"
 #include "strbuf.h"
+#include "strhash.h"
 
 typedef struct {
 	FILE *op;
@@ -29,9 +30,12 @@ typedef struct {
 	int format;		/**< defined in "format.h" */
 	STRBUF *abspath;
 	char basedir[MAXPATHLEN];
+	char root[MAXPATHLEN];	/**< root directory (json, binary) */
 	int start_point;
 	int db;			/**< for gtags-cscope */
 	char *tag_for_display;
+	STRHASH *path_cache;	/**< converted path names */
+	STRBUF *output;		/**< output buffer */
 } CONVERT;
 
 void set_print0(void);
@@ -40,5 +44,7 @@ void convert_put(CONVERT *, const char *);
 void convert_put_path(CONVERT *, const char *, const char *);
 void convert_put_using(CONVERT *, const char *, const char *, int, const char *, const char *);
 void convert_close(CONVERT *cv);
+void convert_put_header(int, FILE *);
+void convert_put_trailer(int, FILE *, int);
 
 #endif /* ! _CONVERT_H_ */
@@ -38,6 +38,9 @@
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
+#if !defined(_WIN32) || defined(__CYGWIN__)
+#include <sys/wait.h>
+#endif
 #if defined(_WIN32) && !defined(__CYGWIN__)
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
@@ -53,22 +56,6 @@
 #include "literal.h"
 #include "convert.h"
 
-/*
- * ensure GTAGSLIBPATH compares correctly
- */
-#if defined(_WIN32) || defined(__DJGPP__)
-#define STRCMP stricmp
-#define back2slash(sb) do {		\
-	char *p = strbuf_value(sb);	\
-	for (; *p; p++) 		\
-		if (*p == '\\')         \
-			*p = '/';       \
-} while (0)
-#else
-#define STRCMP strcmp
-#define back2slash(sb)
-#endif
-
 /*
  * enable [set] globbing, if available
  */
@@ -82,18 +69,19 @@ int _CRT_glob = __CRT_GLOB_USE_MINGW__ | __CRT_GLOB_BRACKET_GROUPS__;
 static void usage(void);
 static void help(void);
 static void setcom(int);
-int decide_tag_by_context(const char *, const char *, int);
+typedef int (*LIBSEARCH)(const char *, const char *, void *);
+static int libsearch(const char *, int, LIBSEARCH, void *, char *);
 int main(int, char **);
 int completion_tags(const char *, const char *, const char *, int);
 void completion(const char *, const char *, const char *, int);
 void completion_idutils(const char *, const char *, const char *);
 void completion_path(const char *, const char *);
-void idutils(const char *, const char *);
-void grep(const char *, char *const *, const char *);
-void pathlist(const char *, const char *);
-void parsefile(char *const *, const char *, const char *, const char *, int);
+int idutils(const char *, const char *);
+int grep(const char *, char *const *, const char *);
+int pathlist(const char *, const char *);
+int parsefile(char *const *, const char *, const char *, const char *, int);
 int search(const char *, const char *, const char *, const char *, int);
-void tagsearch(const char *, const char *, const char *, const char *, int);
+int tagsearch(const char *, const char *, const char *, const char *, int);
 void encode(char *, int, const char *);
 
 const char *localprefix;		/**< local prefix		*/
@@ -251,134 +239,6 @@ setcom(int c)
 	else if (command != c)
 		usage();
 }
-/**
- * decide_tag_by_context: decide tag type by context
- *
- *	@param[in]	tag	tag name
- *	@param[in]	file	context file
- *	@param[in]	lineno	context lineno
- *	@return		GTAGS, GRTAGS, GSYMS
- */
-int
-decide_tag_by_context(const char *tag, const char *file, int lineno)
-{
-#define NEXT_NUMBER(p) do {                                                         \
-	for (n = 0; isdigit(*p); p++)                                               \
-		n = n * 10 + (*p - '0');                                            \
-} while (0)
-	STRBUF *sb = NULL;
-	char path[MAXPATHLEN], s_fid[MAXFIDLEN];
-	const char *tagline, *p;
-	DBOP *dbop;
-	int db = GSYMS;
-	int iscompline = 0;
-
-	if (normalize(file, get_root_with_slash(), cwd, path, sizeof(path)) == NULL)
-		die("'%s' is out of the source project.", file);
-	/*
-	 * get file id
-	 */
-	if (gpath_open(dbpath, 0) < 0)
-		die("GPATH not found.");
-	if ((p = gpath_path2fid(path, NULL)) == NULL)
-		die("path name in the context is not found.");
-	strlimcpy(s_fid, p, sizeof(s_fid));
-	gpath_close();
-	/*
-	 * read btree records directly to avoid the overhead.
-	 */
-	dbop = dbop_open(makepath(dbpath, dbname(GTAGS), NULL), 0, 0, 0);
-	if (dbop == NULL)
-		die("cannot open GTAGS.");
-	if (dbop_getoption(dbop, COMPLINEKEY))
-		iscompline = 1;
-	tagline = dbop_first(dbop, tag, NULL, 0);
-	if (tagline) {
-		db = GTAGS;
-		for (; tagline; tagline = dbop_next(dbop)) {
-			/*
-			 * examine whether the definition record include the context.
-			 */
-			p = locatestring(tagline, s_fid, MATCH_AT_FIRST);
-			if (p != NULL && *p == ' ') {
-				for (p++; *p && *p != ' '; p++)
-					;
-				if (*p++ != ' ' || !isdigit(*p))
-					die("Impossible! decide_tag_by_context(1)");
-				/*
-				 * Standard format	n <blank> <image>$
-				 * Compact format	d,d,d,d$
-				 */
-				if (!iscompline) {			/* Standard format */
-					if (atoi(p) == lineno) {
-						db = GRTAGS;
-						goto finish;
-					}
-				} else {				/* Compact format */
-					int n, cur, last = 0;
-
-					do {
-						if (!isdigit(*p))
-							die("Impossible! decide_tag_by_context(2)");
-						NEXT_NUMBER(p);
-						cur = last + n;
-						if (cur == lineno) {
-							db = GRTAGS;
-							goto finish;
-						}
-						last = cur;
-						if (*p == '-') {
-							if (!isdigit(*++p))
-								die("Impossible! decide_tag_by_context(3)");
-							NEXT_NUMBER(p);
-							cur = last + n;
-							if (lineno >= last && lineno <= cur) {
-								db = GRTAGS;
-								goto finish;
-							}
-							last = cur;
-						}
-						if (*p) {
-							if (*p == ',')
-								p++;
-							else
-								die("Impossible! decide_tag_by_context(4)");
-						}
-					} while (*p);
-				}
-			}
-		}
-	}
-finish:
-	dbop_close(dbop);
-	if (db == GSYMS && getenv("GTAGSLIBPATH")) {
-		char libdbpath[MAXPATHLEN];
-		char *libdir = NULL, *nextp = NULL;
-
-		sb = strbuf_open(0);
-		strbuf_puts(sb, getenv("GTAGSLIBPATH"));
-		back2slash(sb);
-		for (libdir = strbuf_value(sb); libdir; libdir = nextp) {
-			 if ((nextp = locatestring(libdir, PATHSEP, MATCH_FIRST)) != NULL)
-                                *nextp++ = 0;
-			if (!gtagsexist(libdir, libdbpath, sizeof(libdbpath), 0))
-				continue;
-			if (!STRCMP(dbpath, libdbpath))
-				continue;
-			dbop = dbop_open(makepath(libdbpath, dbname(GTAGS), NULL), 0, 0, 0);
-			if (dbop == NULL)
-				continue;
-			tagline = dbop_first(dbop, tag, NULL, 0);
-			dbop_close(dbop);
-			if (tagline != NULL) {
-				db = GTAGS;
-				break;
-			}
-		}
-		strbuf_close(sb);
-	}
-	return db;
-}
 int
 main(int argc, char **argv)
 {
@@ -387,6 +247,7 @@ main(int argc, char **argv)
 	int optchar;
 	int option_index = 0;
 	int status = 0;
+	int count = 0;
 
 	/*
 	 * get path of following directories.
@@ -606,6 +467,10 @@ main(int argc, char **argv)
 				format = FORMAT_GREP;
 			else if (!strcmp(optarg, "cscope"))
 				format = FORMAT_CSCOPE;
+			else if (!strcmp(optarg, "json"))
+				format = FORMAT_JSON;
+			else if (!strcmp(optarg, "binary"))
+				format = FORMAT_BINARY;
 			else
 				die_with_code(2, "unknown format type for the --result option.");
 			break;
@@ -681,6 +546,9 @@ main(int argc, char **argv)
 			use_color = 0;
 		if (Vflag)
 			use_color = 0;
+		/* machine-readable formats are never colored */
+		if (format == FORMAT_JSON || format == FORMAT_BINARY)
+			use_color = 0;
 	}
 	argc -= optind;
 	argv += optind;
@@ -838,9 +706,15 @@ main(int argc, char **argv)
 	 * decide tag type.
 	 */
 	if (context_file) {
+		char path[MAXPATHLEN];
+
 		if (isregex(av))
 			die_with_code(2, "regular expression is not allowed with the --from-here option.");
-		db = decide_tag_by_context(av, context_file, atoi(context_lineno));
+		if (normalize(context_file, get_root_with_slash(), cwd, path, sizeof(path)) == NULL)
+			die("'%s' is out of the source project.", context_file);
+		db = decide_tag_by_context(dbpath, av, path, atoi(context_lineno));
+		if (db == NOTAGS)
+			die("path name in the context is not found.");
 	} else {
 		if (dflag)
 			db = GTAGS;
@@ -935,40 +809,46 @@ main(int argc, char **argv)
 		} else
 			die("invalid path style.");
 	}
+	/*
+	 * The header and the trailer of machine-readable formats enclose
+	 * the records of all the trees searched.
+	 */
+	convert_put_header(format, stdout);
 	/*
 	 * exec lid(idutils).
 	 */
 	if (Iflag) {
 		chdir(root);
-		idutils(av, dbpath);
+		count = idutils(av, dbpath);
 	}
 	/*
 	 * search pattern (regular expression).
 	 */
 	else if (gflag) {
 		chdir(root);
-		grep(av, argv, dbpath);
+		count = grep(av, argv, dbpath);
 	}
 	/*
 	 * locate paths including the pattern.
 	 */
 	else if (Pflag) {
 		chdir(root);
-		pathlist(av, dbpath);
+		count = pathlist(av, dbpath);
 	}
 	/*
 	 * parse source files.
 	 */
 	else if (fflag) {
 		chdir(root);
-		parsefile(argv, cwd, root, dbpath, db);
+		count = parsefile(argv, cwd, root, dbpath, db);
 	}
 	/*
 	 * tag search.
 	 */
 	else {
-		tagsearch(av, cwd, root, dbpath, db);
+		count = tagsearch(av, cwd, root, dbpath, db);
 	}
+	convert_put_trailer(format, stdout, count);
 	return 0;
 }
 /**
@@ -1000,6 +880,118 @@ completion_tags(const char *dbpath, const char *root, const char *prefix, int db
 	gtags_close(gtop);
 	return count;
 }
+/*
+ * Child processes which search the library trees (-T option).
+ */
+#if !defined(_WIN32) || defined(__CYGWIN__)
+struct libchild {
+	pid_t pid;			/**< child process */
+	FILE *op;			/**< output of the child */
+	int fd;				/**< count of the child */
+};
+#endif
+/**
+ * libsearch: search in the library trees of GTAGSLIBPATH.
+ *
+ *	@param[in]	dbpath	database directory of the current tree
+ *	@param[in]	db	GTAGS,GRTAGS,GSYMS
+ *	@param[in]	func	search function for a tree
+ *	@param[in]	arg	argument for func
+ *	@param[out]	used	database directory of the tree which has matches
+ *				(only without the -T option), or NULL
+ *	@return		count of output lines
+ *
+ * Without the -T option, the search stops at the first tree which has
+ * matches. With the -T option, every tree is searched by its own child
+ * process at the same time, and the results are output in library order.
+ */
+static int
+libsearch(const char *dbpath, int db, LIBSEARCH func, void *arg, char *used)
+{
+	VARRAY *vb = libpath_open(dbpath, db);	/* trees which have tag files */
+	LIBTREE *trees = varray_assign(vb, 0, 0), *t;
+	int i, count, total = 0;
+
+#if !defined(_WIN32) || defined(__CYGWIN__)
+	if (Tflag && vb->length > 1) {
+		struct libchild *children = check_calloc(sizeof(struct libchild), vb->length), *c;
+
+		/*
+		 * Each child writes the output into a temporary file
+		 * and the count into a pipe.
+		 */
+		for (i = 0; i < vb->length; i++) {
+			int fd[2];
+
+			t = &trees[i];
+			c = &children[i];
+			if ((c->op = tmpfile()) == NULL)
+				die("cannot make temporary file.");
+			if (pipe(fd) < 0)
+				die("cannot make pipe.");
+			fflush(NULL);
+			if ((c->pid = fork()) < 0)
+				die("cannot fork.");
+			if (c->pid == 0) {
+				close(fd[0]);
+				if (dup2(fileno(c->op), STDOUT_FILENO) < 0)
+					die("cannot redirect output.");
+				count = func(t->dir, t->dbpath, arg);
+				fflush(stdout);
+				if (write(fd[1], &count, sizeof(count)) != sizeof(count))
+					die("cannot write to pipe.");
+				_exit(0);
+			}
+			close(fd[1]);
+			c->fd = fd[0];
+		}
+		for (i = 0; i < vb->length; i++) {
+			char buf[BUFSIZ];
+			size_t n;
+			int status;
+
+			t = &trees[i];
+			c = &children[i];
+			if (read(c->fd, &count, sizeof(count)) != sizeof(count))
+				count = 0;
+			close(c->fd);
+			if (waitpid(c->pid, &status, 0) < 0)
+				die("waitpid failed.");
+			if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+				die("search in '%s' failed.", t->dir);
+			rewind(c->op);
+			while ((n = fread(buf, 1, sizeof(buf), c->op)) > 0)
+				fwrite(buf, 1, n, stdout);
+			fclose(c->op);
+			total += count;
+		}
+		free(children);
+	} else
+#endif
+	for (i = 0; i < vb->length; i++) {
+		t = &trees[i];
+		count = func(t->dir, t->dbpath, arg);
+		total += count;
+		if (count > 0 && !Tflag) {
+			if (used)
+				strlimcpy(used, t->dbpath, MAXPATHLEN);
+			break;
+		}
+	}
+	libpath_close(vb);
+	return total;
+}
+struct completion_arg {
+	const char *prefix;
+	int db;
+};
+static int
+completion_lib(const char *libdir, const char *libdbpath, void *arg)
+{
+	struct completion_arg *p = (struct completion_arg *)arg;
+
+	return completion_tags(libdbpath, libdir, p->prefix, p->db);
+}
 /**
  * completion: print completion list of specified prefix
  *
@@ -1012,41 +1004,20 @@ void
 completion(const char *dbpath, const char *root, const char *prefix, int db)
 {
 	int count, total = 0;
-	char libdbpath[MAXPATHLEN];
 
 	if (prefix && *prefix == 0)	/* In the case global -c '' */
 		prefix = NULL;
 	count = completion_tags(dbpath, root, prefix, db);
+	total += count;
 	/*
 	 * search in library path.
 	 */
 	if (db == GTAGS && getenv("GTAGSLIBPATH") && (count == 0 || Tflag) && !Sflag) {
-		STRBUF *sb = strbuf_open(0);
-		char *libdir, *nextp = NULL;
+		struct completion_arg arg;
 
-		strbuf_puts(sb, getenv("GTAGSLIBPATH"));
-		back2slash(sb);
-		/*
-		 * search for each tree in the library path.
-		 */
-		for (libdir = strbuf_value(sb); libdir; libdir = nextp) {
-			if ((nextp = locatestring(libdir, PATHSEP, MATCH_FIRST)) != NULL)
-				*nextp++ = 0;
-			if (!gtagsexist(libdir, libdbpath, sizeof(libdbpath), 0))
-				continue;
-			if (!STRCMP(dbpath, libdbpath))
-				continue;
-			if (!test("f", makepath(libdbpath, dbname(db), NULL)))
-				continue;
-			/*
-			 * search again
-			 */
-			count = completion_tags(libdbpath, libdir, prefix, db);
-			total += count;
-			if (count > 0 && !Tflag)
-				break;
-		}
-		strbuf_close(sb);
+		arg.prefix = prefix;
+		arg.db = db;
+		total += libsearch(dbpath, db, completion_lib, &arg, NULL);
 	}
 	/* return total; */
 }
@@ -1138,11 +1109,22 @@ completion_path(const char *dbpath, const char *prefix)
 		flags |= IGNORE_CASE;
 #endif
 	gp = gfind_open(dbpath, localprefix, target, 0);
+	/*
+	 * Since GPATH is sorted and has no duplicates, all the paths
+	 * can be printed directly.
+	 */
+	if (prefix == NULL) {
+		while ((path = gfind_read(gp)) != NULL) {
+			fputs(path + 2, stdout);	/* skip './' */
+			fputc('\n', stdout);
+		}
+		gfind_close(gp);
+		dbop_close(dbop);
+		return;
+	}
 	while ((path = gfind_read(gp)) != NULL) {
 		path++;					/* skip '.'*/
-		if (prefix == NULL) {
-			dbop_put(dbop, path + 1, "");
-		} else if (match_part == MATCH_PART_ALL) {
+		if (match_part == MATCH_PART_ALL) {
 			const char *p = path;
 
 			while ((p = locatestring(p, prefix, flags)) != NULL) {
@@ -1217,8 +1199,9 @@ print_count(int number)
  *
  *	@param[in]	pattern	POSIX regular expression
  *	@param[in]	dbpath	"GTAGS" directory
+ *	@return		count of output lines
  */
-void
+int
 idutils(const char *pattern, const char *dbpath)
 {
 	FILE *ip;
@@ -1282,6 +1265,11 @@ idutils(const char *pattern, const char *dbpath)
 		if ((xflag || tflag) && !*p)
 			die("invalid lid(idutils) output format(1). '%s'", grep);
 		p++;
+		/*
+		 * Lid doesn't know the scope. The path name is compared with
+		 * the local prefix, which is cheaper than looking up its file
+		 * id in GPATH to test it with the scope set of gtags_setscope().
+		 */
 		if (Sflag) {
 			if (!locatestring(path, localprefix, MATCH_AT_FIRST))
 				continue;
@@ -1318,6 +1306,7 @@ idutils(const char *pattern, const char *dbpath)
 		print_count(count);
 		fprintf(stderr, " (using idutils index in '%s').\n", dbpath);
 	}
+	return count;
 }
 /**
  * grep: grep pattern
@@ -1325,8 +1314,9 @@ idutils(const char *pattern, const char *dbpath)
  *	@param[in]	pattern	POSIX regular expression
  *	@param	argv
  *	@param	dbpath
+ *	@return		count of output lines
  */
-void
+int
 grep(const char *pattern, char *const *argv, const char *dbpath)
 {
 	FILE *fp;
@@ -1411,7 +1401,12 @@ grep(const char *pattern, char *const *argv, const char *dbpath)
 			}
 			path = buf;
 		}
-		if (Sflag && !locatestring(path, localprefix, MATCH_AT_FIRST))
+		/*
+		 * The files read from GPATH are already in the scope.
+		 * The files specified by the user may not be in GPATH,
+		 * so they are compared with the local prefix.
+		 */
+		if (Sflag && user_specified && !locatestring(path, localprefix, MATCH_AT_FIRST))
 			continue;
 		if (literal) {
 			int n = literal_search(cv, path);
@@ -1447,23 +1442,54 @@ grep(const char *pattern, char *const *argv, const char *dbpath)
 		print_count(count);
 		fprintf(stderr, " (no index used).\n");
 	}
+	return count;
+}
+/**
+ * path_prefix: get the literal prefix of an anchored path pattern.
+ *
+ *	@param[in]	pattern	extended regular expression which begins with '^/'
+ *	@return		prefix (may be empty)
+ *
+ * Every path which matches the pattern begins with the prefix
+ * (after the local prefix).
+ */
+static const char *
+path_prefix(const char *pattern)
+{
+	STATIC_STRBUF(sb);
+	const char *p;
+
+	strbuf_clear(sb);
+	if (strchr(pattern, '|'))		/* alternation */
+		return strbuf_value(sb);
+	for (p = pattern + 2; *p && !isregexchar(*p); p++) {
+		/* a quantifier makes the last character optional */
+		if (p[1] == '*' || p[1] == '?' || p[1] == '{')
+			break;
+		strbuf_putc(sb, *p);
+	}
+	return strbuf_value(sb);
 }
 /**
  * pathlist: print candidate path list.
  *
  *	@param[in]	pattern
  *	@param[in]	dbpath
+ *	@return		count of output lines
  */
-void
+int
 pathlist(const char *pattern, const char *dbpath)
 {
 	GFIND *gp;
 	CONVERT *cv;
+	STRBUF *start = strbuf_open(0);
 	const char *path, *p;
+	const char *substring = NULL, *prefix = "";
 	regex_t preg;
 	int count;
 	int target = GPATH_SOURCE;
 	int gfind_flags = 0;
+	int match_flags = MATCH_FIRST;
 
 	if (oflag)
 		target = GPATH_BOTH;
@@ -1483,6 +1509,14 @@ pathlist(const char *pattern, const char *dbpath)
 		else if (!Mflag)
 			flags |= REG_ICASE;
 #endif /* _WIN32 */
+		if (flags & REG_ICASE)
+			match_flags |= IGNORE_CASE;
+		/*
+		 * A pattern without special characters is searched as
+		 * a substring without regular expression.
+		 */
+		if (literal || !isregex(pattern))
+			substring = pattern;
 		/*
 		 * We assume '^aaa' as '^/aaa'.
 		 */
@@ -1495,6 +1529,12 @@ pathlist(const char *pattern, const char *dbpath)
 		}
 		if (regcomp(&preg, pattern, flags) != 0)
 			die("invalid regular expression.");
+		/*
+		 * The paths which match '^/aaa' are read by a prefix read
+		 * of GPATH.
+		 */
+		if (*pattern == '^' && !Vflag && (flags & (REG_ICASE|REG_EXTENDED)) == REG_EXTENDED)
+			prefix = path_prefix(pattern);
 	}
 	if (!localprefix)
 		localprefix = "./";
@@ -1502,13 +1542,20 @@ pathlist(const char *pattern, const char *dbpath)
 	cv->tag_for_display = "path";
 	count = 0;
 
-	gp = gfind_open(dbpath, localprefix, target, gfind_flags);
+	strbuf_puts(start, localprefix);
+	strbuf_puts(start, prefix);
+	gp = gfind_open(dbpath, strbuf_value(start), target, gfind_flags);
 	while ((path = gfind_read(gp)) != NULL) {
 		/*
 		 * skip localprefix because end-user doesn't see it.
 		 */
 		p = path + strlen(localprefix) - 1;
-		if (pattern) {
+		if (substring) {
+			int result = locatestring(p, substring, match_flags) ? 0 : 1;
+
+			if ((!Vflag && result != 0) || (Vflag && result == 0))
+				continue;
+		} else if (pattern) {
 			int result = regexec(&preg, p, 0, 0, 0);
 
 			if ((!Vflag && result != 0) || (Vflag && result == 0))
@@ -1523,6 +1570,7 @@ pathlist(const char *pattern, const char *dbpath)
 	}
 	gfind_close(gp);
 	convert_close(cv);
+	strbuf_close(start);
 	if (pattern)
 		regfree(&preg);
 	if (vflag) {
@@ -1539,9 +1587,10 @@ pathlist(const char *pattern, const char *dbpath)
 		}
 		fprintf(stderr, " (using '%s').\n", makepath(dbpath, dbname(GPATH), NULL));
 	}
+	return count;
 }
 /**
- * void parsefile(char *const *argv, const char *cwd, const char *root, const char *dbpath, int db)
+ * int parsefile(char *const *argv, const char *cwd, const char *root, const char *dbpath, int db)
  *
  * parsefile: parse file to pick up tags.
  *
@@ -1550,10 +1599,16 @@ pathlist(const char *pattern, const char *dbpath)
  *	@param[in]	root	root directory of source tree
  *	@param[in]	dbpath	dbpath
  *	@param[in]	db	type of parse
+ *	@return		count of output lines
  */
 #define TARGET_DEF	(1 << GTAGS)
 #define TARGET_REF	(1 << GRTAGS)
 #define TARGET_SYM	(1 << GSYMS)
+struct parsefile_entry {
+	const char *path;			/**< path name of the file */
+	int fid;				/**< file id */
+	int indexed;				/**< the file is up to date in GTAGS */
+};
 struct parsefile_data {
 	CONVERT *cv;
 	DBOP *dbop;
@@ -1612,7 +1667,149 @@ put_syms(int type, const char *tag, int lno, const char *path, const char *line_
 	convert_put_using(data->cv, tag, path, lno, line_image, data->fid);
 	data->count++;
 }
-void
+/*
+ * Definitions from GTAGS.
+ *
+ * The definitions of a file which has not been changed since GTAGS was
+ * made are already in GTAGS. When many files are given, reading all of
+ * them from GTAGS with one pass is cheaper than parsing each file.
+ */
+#define DEFTAG_RATIO	8	/**< use GTAGS if 1/8 or more of the files are given */
+struct deftag {
+	int fid;			/**< file id */
+	int lineno;			/**< line number */
+	int column;			/**< column of the tag in the line */
+	const char *tag;		/**< tag name */
+};
+static int
+compare_deftag(const void *s1, const void *s2)
+{
+	const struct deftag *d1 = (const struct deftag *)s1;
+	const struct deftag *d2 = (const struct deftag *)s2;
+
+	if (d1->fid != d2->fid)
+		return d1->fid < d2->fid ? -1 : 1;
+	if (d1->lineno != d2->lineno)
+		return d1->lineno < d2->lineno ? -1 : 1;
+	if (d1->column != d2->column)
+		return d1->column < d2->column ? -1 : 1;
+	return strcmp(d1->tag, d2->tag);
+}
+static void
+add_deftag(VARRAY *vb, int fid, int lineno, const char *tag)
+{
+	struct deftag *d = varray_append(vb);
+
+	d->fid = fid;
+	d->lineno = lineno;
+	d->column = 0;
+	d->tag = tag;
+}
+/**
+ * load_deftags: load the definitions of the files from GTAGS.
+ *
+ *	@param[in]	dbpath	dbpath directory
+ *	@param[in]	root	root directory of source tree
+ *	@param[in]	fids	file ids of the files
+ *	@param[in]	pool	pool for tag names
+ *	@return		definitions sorted by file id and line number
+ */
+static VARRAY *
+load_deftags(const char *dbpath, const char *root, IDSET *fids, POOL *pool)
+{
+	GTOP *gtop = gtags_open(dbpath, root, GTAGS, GTAGS_READ, 0);
+	VARRAY *vb = varray_open(sizeof(struct deftag), 1000);
+	const char *tagline;
+
+	/*
+	 * Standard format: <file id> <tag name> <line number> <line image>
+	 * Compact format:  <file id> <tag name> <line number>,...
+	 */
+	for (tagline = dbop_first(gtop->dbop, NULL, NULL, 0); tagline; tagline = dbop_next(gtop->dbop)) {
+		const char *p = tagline;
+		const char *name, *tag;
+		int fid, n = 0;
+
+		for (fid = 0; isdigit(*p); p++)
+			fid = fid * 10 + (*p - '0');
+		if (*p != ' ')
+			die("invalid tag record. '%s'", tagline);
+		if (!idset_contains(fids, fid))
+			continue;
+		/*
+		 * Take the tag name from the record, because the key is
+		 * the method name with GTAGS_EXTRACTMETHOD.
+		 */
+		name = ++p;
+		for (; *p && *p != ' '; p++)
+			;
+		if (*p++ != ' ' || !isdigit(*p))
+			die("invalid tag record. '%s'", tagline);
+		tag = strmake(name, " ");
+		if (gtop->format & GTAGS_COMPNAME)
+			tag = uncompress(tag, gtop->dbop->lastkey);
+		tag = pool_strdup(pool, tag, 0);
+		if (!(gtop->format & GTAGS_COMPACT)) {
+			for (n = 0; isdigit(*p); p++)
+				n = n * 10 + (*p - '0');
+			add_deftag(vb, fid, n, tag);
+		} else {
+			LNOLIST l;
+
+			lnolist_open(&l, p, gtop->format & GTAGS_COMPLINE);
+			while ((n = lnolist_next(&l)) > 0)
+				add_deftag(vb, fid, n, tag);
+		}
+	}
+	gtags_close(gtop);
+	if (vb->length > 0)
+		qsort(varray_assign(vb, 0, 0), vb->length, sizeof(struct deftag), compare_deftag);
+	return vb;
+}
+/**
+ * put_deftags: output the definitions of a file loaded from GTAGS.
+ *
+ *	@param[in]	vb	definitions
+ *	@param[in]	fid	file id
+ *	@param[in]	root	root directory of source tree
+ *	@param[in]	path	path name of the file
+ *	@param[in]	data	parsefile data
+ *
+ * The definitions in a line are output in the order of the column
+ * like parse_file().
+ */
+static void
+put_deftags(VARRAY *vb, int fid, const char *root, const char *path, struct parsefile_data *data)
+{
+	struct deftag *deftags = varray_assign(vb, 0, 0);
+	int lo = 0, hi = vb->length, i, j;
+	const char *image;
+	SRCLINE *srcline;
+
+	/* binary search for the first definition of the file */
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		if (deftags[mid].fid < fid)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == vb->length || deftags[lo].fid != fid)
+		return;
+	srcline = srcline_open(root, SRCLINE_WARNING);
+	for (i = lo; i < vb->length && deftags[i].fid == fid; i = j) {
+		image = srcline_get(srcline, path, deftags[i].lineno);
+		for (j = i; j < vb->length && deftags[j].fid == fid && deftags[j].lineno == deftags[i].lineno; j++)
+			deftags[j].column = srcline_column(image, deftags[j].tag);
+		if (j - i > 1)
+			qsort(&deftags[i], j - i, sizeof(struct deftag), compare_deftag);
+		for (; i < j; i++)
+			put_syms(PARSER_DEF, deftags[i].tag, deftags[i].lineno, path, image, data);
+	}
+	srcline_close(srcline);
+}
+int
 parsefile(char *const *argv, const char *cwd, const char *root, const char *dbpath, int db)
 {
 	int count = 0;
@@ -1622,6 +1819,10 @@ parsefile(char *const *argv, const char *cwd, const char *root, const char *dbpa
 	const char *plugin_parser, *av;
 	char path[MAXPATHLEN];
 	struct parsefile_data data;
+	VARRAY *files, *deftags = NULL;
+	IDSET *fids = NULL;
+	POOL *pool;
+	int i;
 
 	flags = 0;
 	if (vflag)
@@ -1671,7 +1872,19 @@ parsefile(char *const *argv, const char *cwd, const char *root, const char *dbpa
 		args_open_filelist(file_list);
 	else
 		args_open_nop();
+	/*
+	 * pick up the files, and examine whether they have been changed
+	 * since gtags parsed them.
+	 */
+	pool = pool_open();
+	files = varray_open(sizeof(struct parsefile_entry), 100);
+	if (data.target == TARGET_DEF)
+		fids = idset_open(gpath_nextkey());
 	while ((av = args_read()) != NULL) {
+		struct parsefile_entry *entry;
+		const char *p;
+		int type = 0;
+
 		/*
 		 * convert the path into relative to the root directory of source tree.
 		 */
@@ -1692,25 +1905,53 @@ parsefile(char *const *argv, const char *cwd, const char *root, const char *dbpa
 		/*
 		 * Memorize the file id of the path. This is used in put_syms().
 		 */
-		{
-			static char s_fid[MAXFIDLEN];
-			int type = 0;
-			const char *p = gpath_path2fid(path, &type);
-
-			if (!p || type != GPATH_SOURCE) {
-				if (!qflag)
-					die("'%s' is not a source file.", av);
-				continue;
-			}
-			strlimcpy(s_fid, p, sizeof(s_fid));
-			data.fid = s_fid;
+		p = gpath_path2fid(path, &type);
+		if (!p || type != GPATH_SOURCE) {
+			if (!qflag)
+				die("'%s' is not a source file.", av);
+			continue;
 		}
 		if (Sflag && !locatestring(path, localprefix, MATCH_AT_FIRST))
 			continue;
+		entry = varray_append(files);
+		entry->path = pool_strdup(pool, path, 0);
+		entry->fid = atoi(p);
+		entry->indexed = 0;
+		if (fids != NULL) {
+			struct stat sb;
+
+			/*
+			 * The file is up to date only if it has not been modified
+			 * since gtags began to read it. The modification time of
+			 * GTAGS is not usable, because it is updated by the
+			 * --single-update option for another file.
+			 */
+			if (stat(makepath(root, path, NULL), &sb) == 0 && sb.st_mtime < gpath_getstamp(path)) {
+				entry->indexed = 1;
+				idset_add(fids, entry->fid);
+			}
+		}
+	}
+	if (fids != NULL) {
+		if (idset_count(fids) > 0 && idset_count(fids) * DEFTAG_RATIO >= (unsigned int)gpath_nextkey())
+			deftags = load_deftags(dbpath, root, fids, pool);
+		idset_close(fids);
+	}
+	for (i = 0; i < files->length; i++) {
+		struct parsefile_entry *entry = varray_assign(files, i, 0);
+		char s_fid[MAXFIDLEN];
+
+		snprintf(s_fid, sizeof(s_fid), "%d", entry->fid);
+		data.fid = s_fid;
 		data.count = 0;
-		parse_file(path, flags, put_syms, &data);
+		if (deftags != NULL && entry->indexed)
+			put_deftags(deftags, entry->fid, root, entry->path, &data);
+		else
+			parse_file(entry->path, flags, put_syms, &data);
 		count += data.count;
 	}
+	varray_close(files);
+	pool_close(pool);
 	args_close();
 	parser_exit();
 	/*
@@ -1723,8 +1964,14 @@ parsefile(char *const *argv, const char *cwd, const char *root, const char *dbpa
 	strbuf_close(sb);
 	if (vflag) {
 		print_count(count);
-		fprintf(stderr, " (no index used).\n");
+		if (deftags != NULL)
+			fprintf(stderr, " (using '%s').\n", makepath(dbpath, dbname(GTAGS), NULL));
+		else
+			fprintf(stderr, " (no index used).\n");
 	}
+	if (deftags != NULL)
+		varray_close(deftags);
+	return count;
 }
 /**
  * search: search specified function 
@@ -1766,9 +2013,13 @@ search(const char *pattern, const char *root, const char *cwd, const char *dbpat
 		flags |= GTOP_PATH;
 	if (iflag)
 		flags |= GTOP_IGNORECASE;
+	/*
+	 * Records out of the scope are dropped in gtags_first() and
+	 * gtags_next() before the path names are looked up.
+	 */
+	if (Sflag)
+		gtags_setscope(gtop, dbpath, localprefix);
 	for (gtp = gtags_first(gtop, pattern, flags); gtp; gtp = gtags_next(gtop)) {
-		if (Sflag && !locatestring(gtp->path, localprefix, MATCH_AT_FIRST))
-			continue;
 		count += output_with_formatting(cv, gtp, root, gtop->format);
 	}
 	convert_close(cv);
@@ -1778,6 +2029,18 @@ search(const char *pattern, const char *root, const char *cwd, const char *dbpat
 	end_output();
 	return count;
 }
+struct search_arg {
+	const char *pattern;
+	const char *cwd;
+	int db;
+};
+static int
+search_lib(const char *libdir, const char *libdbpath, void *arg)
+{
+	struct search_arg *p = (struct search_arg *)arg;
+
+	return search(p->pattern, libdir, p->cwd, libdbpath, p->db);
+}
 /**
  * tagsearch: execute tag search
  *
@@ -1786,28 +2049,19 @@ search(const char *pattern, const char *root, const char *cwd, const char *dbpat
  *	@param[in]	root		root of source tree
  *	@param[in]	dbpath		database directory
  *	@param[in]	db		GTAGS,GRTAGS,GSYMS
+ *	@return			count of output lines
  */
-void
+int
 tagsearch(const char *pattern, const char *cwd, const char *root, const char *dbpath, int db)
 {
 	int count, total = 0;
-	char buffer[IDENTLEN], *p = buffer;
 	char libdbpath[MAXPATHLEN];
 
 	/*
 	 * trim pattern (^<no regex>$ => <no regex>)
 	 */
-	if (!literal && pattern) {
-		strlimcpy(p, pattern, sizeof(buffer));
-		if (*p++ == '^') {
-			char *q = p + strlen(p);
-			if (*--q == '$') {
-				*q = 0;
-				if (*p == 0 || !isregex(p))
-					pattern = p;
-			}
-		}
-	}
+	if (!literal && pattern)
+		pattern = trim_pattern(pattern);
 	/*
 	 * search in current source tree.
 	 */
@@ -1819,35 +2073,16 @@ tagsearch(const char *pattern, const char *cwd, const char *root, const char *db
 	if (abslib)
 		type = PATH_ABSOLUTE;
 	if (db == GTAGS && getenv("GTAGSLIBPATH") && (count == 0 || Tflag) && !Sflag) {
-		STRBUF *sb = strbuf_open(0);
-		char *libdir, *nextp = NULL;
+		struct search_arg arg;
 
-		strbuf_puts(sb, getenv("GTAGSLIBPATH"));
-		back2slash(sb);
-		/*
-		 * search for each tree in the library path.
-		 */
-		for (libdir = strbuf_value(sb); libdir; libdir = nextp) {
-			if ((nextp = locatestring(libdir, PATHSEP, MATCH_FIRST)) != NULL)
-				*nextp++ = 0;
-			if (!gtagsexist(libdir, libdbpath, sizeof(libdbpath), 0))
-				continue;
-			if (!STRCMP(dbpath, libdbpath))
-				continue;
-			if (!test("f", makepath(libdbpath, dbname(db), NULL)))
-				continue;
-			/*
-			 * search again
-			 */
-			count = search(pattern, libdir, cwd, libdbpath, db);
-			total += count;
-			if (count > 0 && !Tflag) {
-				/* for verbose message */
-				dbpath = libdbpath;
-				break;
-			}
-		}
-		strbuf_close(sb);
+		arg.pattern = pattern;
+		arg.cwd = cwd;
+		arg.db = db;
+		libdbpath[0] = '\0';
+		total += libsearch(dbpath, db, search_lib, &arg, libdbpath);
+		/* for verbose message */
+		if (libdbpath[0])
+			dbpath = libdbpath;
 	}
 	if (vflag) {
 		print_count(total);
@@ -1855,6 +2090,7 @@ tagsearch(const char *pattern, const char *cwd, const char *root, const char *db
 			fprintf(stderr, " (using '%s')", makepath(dbpath, dbname(db), NULL));
 		fputs(".\n", stderr);
 	}
+	return total;
 }
 /*
  * encode: string copy with converting blank chars into %ff format.
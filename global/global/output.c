@@ -43,14 +43,6 @@ extern const char *root;
 extern int nosource;
 extern int format;
 
-/** get next number and seek to the next character */
-#define GET_NEXT_NUMBER(p) do {                                                \
-                if (!isdigit(*p))                                              \
-                        p++;                                                   \
-                for (n = 0; isdigit(*p); p++)                                  \
-                        n = n * 10 + (*p - '0');                               \
-        } while (0)
-
 void
 start_output(void)
 {
@@ -100,6 +92,7 @@ put_compact_format(CONVERT *cv, GTP *gtp, const char *root, int flags)
 	int count = 0;
 	char *p = (char *)gtp->tagline;
 	const char *fid, *tagname;
+	LNOLIST l;
 	int n = 0;
 
 	strbuf_clear(ib);
@@ -147,74 +140,29 @@ put_compact_format(CONVERT *cv, GTP *gtp, const char *root, int flags)
 		die("invalid compact format.");
 	if (flags & GTAGS_COMPNAME)
 		tagname = (char *)uncompress(tagname, gtp->tag);
-	if (flags & GTAGS_COMPLINE) {
-		/*
-		 * If GTAGS_COMPLINE flag is set, each line number is expressed as
-		 * the difference from the previous line number except for the head.
-		 * Please see flush_pool() in libutil/gtagsop.c for the details.
-		 */
-		int last = 0, cont = 0;
-
-		while (*p || cont > 0) {
-			if (cont > 0) {
-				n = last + 1;
-				if (n > cont) {
-					cont = 0;
-					continue;
-				}
-			} else if (isdigit(*p)) {
-				GET_NEXT_NUMBER(p);
-			}  else if (*p == '-') {
-				GET_NEXT_NUMBER(p);
-				cont = n + last;
-				n = last + 1;
-			} else if (*p == ',') {
-				GET_NEXT_NUMBER(p);
-				n += last;
-			}
-			if (last_lineno != n && fp) {
-				while (cur_lineno < n) {
-					if (!(src = strbuf_fgets(ib, fp, STRBUF_NOCRLF))) {
-						src = "";
-						fclose(fp);
-						fp = NULL;
-						break;
-					}
-					cur_lineno++;
-				}
-			}
-			convert_put_using(cv, tagname, gtp->path, n, src, fid);
-			count++;
-			last_lineno = last = n;
-		}
-	} else {
-		/*
-		 * In fact, when GTAGS_COMPACT is set, GTAGS_COMPLINE is allways set.
-		 * Therefore, the following code are not actually used.
-		 * However, it is left for some test.
-		 */
-		while (*p) {
-			for (n = 0; isdigit(*p); p++)
-				n = n * 10 + *p - '0';
-			if (*p == ',')
-				p++;
-			if (last_lineno == n)
-				continue;
-			if (last_lineno != n && fp) {
-				while (cur_lineno < n) {
-					if (!(src = strbuf_fgets(ib, fp, STRBUF_NOCRLF))) {
-						src = "";
-						fclose(fp);
-						fp = NULL;
-						break;
-					}
-					cur_lineno++;
+	/*
+	 * If GTAGS_COMPLINE flag is set, each line number is expressed as
+	 * the difference from the previous line number except for the head.
+	 * In fact, when GTAGS_COMPACT is set, GTAGS_COMPLINE is allways set.
+	 */
+	lnolist_open(&l, p, flags & GTAGS_COMPLINE);
+	while ((n = lnolist_next(&l)) > 0) {
+		if (!(flags & GTAGS_COMPLINE) && last_lineno == n)
+			continue;
+		if (last_lineno != n && fp) {
+			while (cur_lineno < n) {
+				if (!(src = strbuf_fgets(ib, fp, STRBUF_NOCRLF))) {
+					src = "";
+					fclose(fp);
+					fp = NULL;
+					break;
 				}
+				cur_lineno++;
 			}
-			convert_put_using(cv, tagname, gtp->path, n, src, fid);
-			count++;
-			last_lineno = n;
 		}
+		convert_put_using(cv, tagname, gtp->path, n, src, fid);
+		count++;
+		last_lineno = n;
 	}
 	return count;
 }
@@ -45,6 +45,7 @@ rebuild(void)
 {
 	char com[16];
 
+	findclose();		/* the tag files are rewritten */
 	snprintf(com, sizeof(com), "%s -i", gtags_command);
 	if (system(com) != 0) {
 		postfatal("gtags-cscope: '%s' failed.\n", com);
@@ -439,8 +439,6 @@ search(void)
 		return(NO);
 	}
 #ifdef _WIN32
-	/* close it again, otherwise the redirection won't work */
-	(void) fclose(refsfound);
 	/* remember the current console mode, since the system */
 	/* call resets it, thus preventing ctrl(c) from working */
 	GetConsoleMode(GetStdHandle(STD_INPUT_HANDLE), &savemode);
@@ -459,10 +457,9 @@ search(void)
 
 #ifdef _WIN32
 	SetConsoleMode(GetStdHandle(STD_INPUT_HANDLE), savemode);
-#else
+#endif
 	/* reopen the references found file for reading */
 	(void) fclose(refsfound);
-#endif
 	if ((refsfound = myfopen(temp1, "r")) == NULL) {
 		cannotopen(temp1);
 		return(NO);
@@ -17,20 +17,463 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include "global-cscope.h"
+#include <regex.h>
+#include "abs2rel.h"
 #include "char.h"
+#include "checkalloc.h"
+#include "compress.h"
+#include "conf.h"
+#include "die.h"
+#include "encodepath.h"
+#include "getdbpath.h"
 #include "gparam.h"
+#include "gpathop.h"
+#include "gtagsop.h"
+#include "libpath.h"
+#include "lnolist.h"
+#include "locatestring.h"
+#include "makepath.h"
+#include "path.h"
+#include "srcline.h"
+#include "strbuf.h"
+#include "strlimcpy.h"
+#include "test.h"
 
-#define FAILED "global command failed"
+/*
+ * Query engine.
+ *
+ * Each request from the menu is answered in-process instead of invoking
+ * global(1) through the shell. Tag files, including those of the library
+ * projects in GTAGSLIBPATH, are opened at the first query which needs them
+ * and kept open across queries; findclose() closes them before the tag
+ * files are rebuilt, and the next query opens them again.
+ *
+ * The output is the same as that of 'global --result=cscope --encode-path=" \t"'.
+ */
+static GTOP *gtop_cache[GRTAGS + GSYMS + 1];
+static char dbpath[MAXPATHLEN];
+static char root[MAXPATHLEN];
+static char cwd[MAXPATHLEN];
+static int ready;
+/*
+ * Library projects (GTAGSLIBPATH).
+ *
+ * Only one GPATH is used at a time in a process (see gpathop.c), so the
+ * GPATH of the projects other than the one in use is kept detached.
+ */
+struct libtree {
+	char dir[MAXPATHLEN];		/**< root directory */
+	char dbpath[MAXPATHLEN];	/**< database directory */
+	GTOP *gtop;			/**< GTAGS */
+	GPATH_CONTEXT *gpath;		/**< detached GPATH */
+};
+static struct libtree *libtrees;
+static int libcount;
+static struct libtree *inuse;		/**< NULL: the project is in use */
+static GPATH_CONTEXT *project_gpath;	/**< detached GPATH of the project */
+/*
+ * Resources used by a query. A query may be interrupted by longjmp(3)
+ * (see search() in display.c), so they are released at the next query.
+ */
+static GFIND *gp;
+static FILE *ip;
+static regex_t preg;
+static int preg_used;
+static SRCLINE *srcline;
 
-static char comline[MAXFILLEN];
+/** release resources which were left by the last query */
+static void
+cleanup(void)
+{
+	if (gp) {
+		gfind_close(gp);
+		gp = NULL;
+	}
+	if (ip) {
+		fclose(ip);
+		ip = NULL;
+	}
+	if (preg_used) {
+		regfree(&preg);
+		preg_used = 0;
+	}
+	if (srcline) {
+		srcline_close(srcline);
+		srcline = NULL;
+	}
+}
+/**
+ * use_tree: attach the GPATH of the project or a library project.
+ *
+ *	@param[in]	lib	library project, NULL: the project
+ */
+static void
+use_tree(struct libtree *lib)
+{
+	if (lib == inuse)
+		return;
+	if (inuse)
+		inuse->gpath = gpath_detach();
+	else
+		project_gpath = gpath_detach();
+	if (lib) {
+		gpath_attach(lib->gpath);
+		lib->gpath = NULL;
+	} else {
+		gpath_attach(project_gpath);
+		project_gpath = NULL;
+	}
+	inuse = lib;
+}
+/**
+ * load_libtrees: load the library projects which have GTAGS.
+ */
+static void
+load_libtrees(void)
+{
+	VARRAY *vb = libpath_open(dbpath, GTAGS);
+	LIBTREE *trees = varray_assign(vb, 0, 0);
+	int i;
 
+	libcount = vb->length;
+	if (libcount > 0)
+		libtrees = (struct libtree *)check_calloc(sizeof(struct libtree), libcount);
+	for (i = 0; i < libcount; i++) {
+		strlimcpy(libtrees[i].dir, trees[i].dir, sizeof(libtrees[i].dir));
+		strlimcpy(libtrees[i].dbpath, trees[i].dbpath, sizeof(libtrees[i].dbpath));
+	}
+	libpath_close(vb);
+}
+/** called from die() in libutil */
+static void
+exit_proc(void)
+{
+	myexit(1);
+}
+/**
+ * findopen: setup the query engine.
+ *
+ *	@return		NULL: succeeded, otherwise: error message
+ */
 static char *
-common(void)
+findopen(void)
+{
+	cleanup();
+	if (ready) {
+		/* a query may have been interrupted while a library was in use */
+		use_tree(NULL);
+		return NULL;
+	}
+	if (setupdbpath(0) < 0)
+		return (char *)gtags_dbpath_error;
+	strlimcpy(dbpath, get_dbpath(), sizeof(dbpath));
+	strlimcpy(root, get_root(), sizeof(root));
+	strlimcpy(cwd, get_cwd(), sizeof(cwd));
+	set_encode_chars((unsigned char *)" \t");
+	sethandler(exit_proc);
+	openconf(root);
+	load_libtrees();
+	ready = 1;
+	return NULL;
+}
+/**
+ * findclose: close the tag files.
+ *
+ * [Note] They must be closed before the tag files are rebuilt.
+ */
+void
+findclose(void)
 {
-	static char com[80];
-	snprintf(com, sizeof(com), "%s --encode-path=\" \t\" --result=cscope%s%s",
-		global_command, (caseless == YES) ? " -i" : "", (absolutepath == YES) ? " -a" : ""); 
-	return com;
+	int db, i;
+
+	cleanup();
+	for (i = 0; i < libcount; i++) {
+		if (libtrees[i].gtop) {
+			use_tree(&libtrees[i]);
+			gtags_close(libtrees[i].gtop);
+			libtrees[i].gtop = NULL;
+		}
+	}
+	use_tree(NULL);
+	for (db = 0; db < (int)(sizeof(gtop_cache) / sizeof(GTOP *)); db++) {
+		if (gtop_cache[db]) {
+			gtags_close(gtop_cache[db]);
+			gtop_cache[db] = NULL;
+		}
+	}
+}
+/**
+ * tags_usable: whether the tag file and GPATH can be read.
+ *
+ *	@param[in]	db	GPATH, GTAGS, GRTAGS, GSYMS or GRTAGS + GSYMS
+ *	@return		1: usable, 0: not usable
+ *
+ * Since die() ends the session, the tag files are examined before
+ * they are opened by the functions in libutil.
+ */
+static int
+tags_usable(int db)
+{
+	return test("fr", makepath(dbpath, dbname(GPATH), NULL))
+	    && test("fr", makepath(dbpath, dbname(db == GSYMS ? GRTAGS : db), NULL));
+}
+/**
+ * opentags: return the descriptor of the tag file, opening it if needed.
+ *
+ *	@param[in]	db	GTAGS, GRTAGS, GSYMS or GRTAGS + GSYMS
+ *	@return		descriptor, NULL: the tag files are not usable
+ */
+static GTOP *
+opentags(int db)
+{
+	if (gtop_cache[db] == NULL) {
+		if (!tags_usable(db))
+			return NULL;
+		gtop_cache[db] = gtags_open(dbpath, root, db, GTAGS_READ, 0);
+	}
+	return gtop_cache[db];
+}
+/**
+ * putline: write a line in cscope format into the references found file.
+ *
+ *	@param[in]	tag	tag name
+ *	@param[in]	base	root directory of path
+ *	@param[in]	path	path name (./...)
+ *	@param[in]	lineno	line number
+ *	@param[in]	image	line image
+ *	@param[in]	include	1: replace the first '<unknown>' with '<global>'
+ */
+static void
+putline(const char *tag, const char *base, const char *path, int lineno, const char *image, int include)
+{
+	STATIC_STRBUF(sb);
+	char buf[MAXPATHLEN];
+	const char *abspath = makepath(base, path + 2, NULL);
+	const char *p;
+	char *q;
+
+	p = abspath;
+	if (absolutepath == NO) {
+#if defined(_WIN32) || defined(__DJGPP__)
+		/* use absolute if on different drives. */
+		if (tolower(*abspath) == tolower(*cwd)) {
+			const char *a = abspath, *b = cwd;
+
+			while (*a != '/')
+				a++;
+			while (*b != '/')
+				b++;
+			if (abs2rel(a, b, buf, sizeof(buf)))
+				p = buf;
+		}
+#else
+		if (abs2rel(abspath, cwd, buf, sizeof(buf)))
+			p = buf;
+#endif
+	}
+	strbuf_clear(sb);
+	for (; *p; p++) {
+		if (required_encode(*p))
+			strbuf_sprintf(sb, "%%%02x", (unsigned char)*p);
+		else
+			strbuf_putc(sb, *p);
+	}
+	for (; *image && isspace((unsigned char)*image); image++)
+		;
+	strbuf_sprintf(sb, " %s %d %s", tag, lineno, *image ? image : "<unknown>");
+	/*
+	 * same as 'sed "s/<unknown>/<global>/"'
+	 */
+	if (include && (q = locatestring(strbuf_value(sb), "<unknown>", MATCH_FIRST)) != NULL) {
+		*q = '\0';
+		fprintf(refsfound, "%s<global>%s\n", strbuf_value(sb), q + 9);
+	} else
+		fprintf(refsfound, "%s\n", strbuf_value(sb));
+}
+/**
+ * skipfields: skip the fields of a tag record.
+ *
+ *	@param[in]	tagline	tag record (<file id> <tag name> ...)
+ *	@param[in]	n	number of fields
+ *	@return		the following field
+ */
+static const char *
+skipfields(const char *tagline, int n)
+{
+	const char *p = tagline;
+
+	for (; n > 0 && *p; n--) {
+		while (*p && *p != ' ')
+			p++;
+		if (*p)
+			p++;
+	}
+	return p;
+}
+/**
+ * puttags: write records of a tag search.
+ *
+ *	@param[in]	gtop	descriptor of the tag file
+ *	@param[in]	base	root directory of the tag file
+ *	@param[in]	pattern	search pattern
+ *	@return		number of written lines
+ */
+static int
+puttags(GTOP *gtop, const char *base, const char *pattern)
+{
+	GTP *gtp;
+	int flags = 0, count = 0;
+
+	if (caseless == YES)
+		flags |= GTOP_IGNORECASE;
+	for (gtp = gtags_first(gtop, pattern, flags); gtp; gtp = gtags_next(gtop)) {
+		if (gtop->format & GTAGS_COMPACT) {
+			LNOLIST l;
+			int n;
+
+			if (srcline == NULL)
+				srcline = srcline_open(base, 0);
+			lnolist_open(&l, skipfields(gtp->tagline, 2), gtop->format & GTAGS_COMPLINE);
+			while ((n = lnolist_next(&l)) > 0) {
+				putline(gtp->tag, base, gtp->path, n, srcline_get(srcline, gtp->path, n), 0);
+				count++;
+			}
+		} else {
+			/*
+			 * tagline = <file id> <tag name> <line no> <line image>
+			 */
+			const char *image = skipfields(gtp->tagline, 3);
+
+			if (gtop->format & GTAGS_COMPRESS)
+				image = uncompress(image, gtp->tag);
+			putline(gtp->tag, base, gtp->path, gtp->lineno, image, 0);
+			count++;
+		}
+	}
+	if (srcline) {
+		srcline_close(srcline);
+		srcline = NULL;
+	}
+	return count;
+}
+/**
+ * searchlib: search for the pattern in the library path (GTAGSLIBPATH).
+ *
+ *	@param[in]	pattern	search pattern
+ *	@param[in]	db	GTAGS
+ *	@return		number of written lines
+ *
+ * The search stops at the first library which has the pattern.
+ */
+static int
+searchlib(const char *pattern, int db)
+{
+	int i, count = 0;
+
+	for (i = 0; i < libcount && count == 0; i++) {
+		struct libtree *lib = &libtrees[i];
+
+		use_tree(lib);
+		if (lib->gtop == NULL)
+			lib->gtop = gtags_open(lib->dbpath, lib->dir, db, GTAGS_READ, 0);
+		count = puttags(lib->gtop, lib->dir, pattern);
+	}
+	use_tree(NULL);
+	return count;
+}
+/**
+ * tagsearch: search for the pattern in the tag file.
+ *
+ *	@param[in]	pattern	search pattern
+ *	@param[in]	db	GTAGS, GRTAGS, GSYMS or GRTAGS + GSYMS
+ *	@return		NULL: succeeded, otherwise: error message
+ */
+static char *
+tagsearch(const char *pattern, int db)
+{
+	GTOP *gtop;
+	int count;
+
+	/*
+	 * gtags_first() dies with an invalid regular expression.
+	 */
+	if (isregex(pattern)) {
+		if (regcomp(&preg, pattern, REG_EXTENDED | (caseless == YES ? REG_ICASE : 0)) != 0)
+			return "invalid regular expression";
+		regfree(&preg);
+	}
+	if ((gtop = opentags(db)) == NULL)
+		return "tag files not found or not readable";
+	/*
+	 * trim pattern (^<no regex>$ => <no regex>)
+	 */
+	pattern = trim_pattern(pattern);
+	count = puttags(gtop, root, pattern);
+	if (count == 0 && db == GTAGS)
+		searchlib(pattern, db);
+	return NULL;
+}
+/**
+ * grepsearch: search for the pattern in the source files.
+ *
+ *	@param[in]	pattern	search pattern
+ *	@param[in]	literal	1: literal string, 0: extended regular expression
+ *	@param[in]	include	1: search for #include lines
+ *	@return		NULL: succeeded, otherwise: error message
+ */
+static char *
+grepsearch(const char *pattern, int literal, int include)
+{
+	STRBUF *ib = strbuf_open(MAXBUFLEN);
+	STRBUF *tag = strbuf_open(0);
+	const char *path, *p, *line;
+	int lineno;
+
+	/*
+	 * convert spaces into %FF format.
+	 */
+	for (p = pattern; *p; p++) {
+		if (*p == '%' || *p == ' ' || *p == '\t')
+			strbuf_sprintf(tag, "%%%02x", *p);
+		else
+			strbuf_putc(tag, *p);
+	}
+	if (!literal) {
+		if (regcomp(&preg, pattern, REG_EXTENDED | (caseless == YES ? REG_ICASE : 0)) != 0) {
+			strbuf_close(tag);
+			strbuf_close(ib);
+			return "invalid regular expression";
+		}
+		preg_used = 1;
+	}
+	if (!tags_usable(GPATH)) {
+		strbuf_close(tag);
+		strbuf_close(ib);
+		return "tag files not found or not readable";
+	}
+	gp = gfind_open(dbpath, NULL, GPATH_SOURCE, 0);
+	while ((path = gfind_read(gp)) != NULL) {
+		if (!(ip = fopen(makepath(root, path, NULL), "r")))
+			continue;
+		lineno = 0;
+		while ((line = strbuf_fgets(ib, ip, STRBUF_NOCRLF)) != NULL) {
+			lineno++;
+			if (literal) {
+				if (!locatestring(line, pattern, MATCH_FIRST | (caseless == YES ? IGNORE_CASE : 0)))
+					continue;
+			} else {
+				if (regexec(&preg, line, 0, 0, 0) != 0)
+					continue;
+			}
+			putline(strbuf_value(tag), root, path, lineno, line, include);
+		}
+		fclose(ip);
+		ip = NULL;
+	}
+	cleanup();
+	strbuf_close(tag);
+	strbuf_close(ib);
+	return NULL;
 }
 /*
  * [display.c]
@@ -40,13 +483,13 @@ common(void)
 char *
 findsymbol(char *pattern)
 {
-	snprintf(comline, sizeof(comline), "%s -d %s > %s", common(), quote_shell(pattern), temp1);
-	if (system(comline) != 0)
-		return FAILED;
-	snprintf(comline, sizeof(comline), "%s -rs %s >> %s", common(), quote_shell(pattern), temp1);
-	if (system(comline) != 0)
-		return FAILED;
-	return NULL;
+	char *msg;
+
+	if ((msg = findopen()) != NULL)
+		return msg;
+	if ((msg = tagsearch(pattern, GTAGS)) != NULL)
+		return msg;
+	return tagsearch(pattern, GRTAGS + GSYMS);
 }
 
 /*
@@ -57,10 +500,11 @@ findsymbol(char *pattern)
 char *
 finddef(char *pattern)
 {
-	snprintf(comline, sizeof(comline), "%s -d %s > %s", common(), quote_shell(pattern), temp1);
-	if (system(comline) != 0)
-		return FAILED;
-	return NULL;
+	char *msg;
+
+	if ((msg = findopen()) != NULL)
+		return msg;
+	return tagsearch(pattern, GTAGS);
 }
 
 /*
@@ -75,18 +519,33 @@ finddef(char *pattern)
 char *
 findcalledby(char *pattern)
 {
-	char *p;
+	char path[MAXPATHLEN];
+	char *p, *msg;
+	int db, lineno;
 
+	if ((msg = findopen()) != NULL)
+		return msg;
 	/*
 	 * <symbol>:<line number>:<path>
 	 */
 	for (p = pattern; *p && *p != ':'; p++)
 		;
 	*p++ = '\0';
-	snprintf(comline, sizeof(comline), "%s --from-here=\"%s\" %s > %s", common(), p, quote_shell(pattern), temp1);
-	if (system(comline) != 0)
-		return FAILED;
-	return NULL;
+	lineno = atoi(p);
+	for (; *p && *p != ':'; p++)
+		;
+	if (*p++ != ':' || lineno <= 0)
+		return "usage: <symbol>:<line number>:<path>";
+	if (isregex(pattern))
+		return "regular expression is not allowed";
+	if (normalize(p, get_root_with_slash(), cwd, path, sizeof(path)) == NULL)
+		return "path name in the context is not found";
+	if (!tags_usable(GTAGS))
+		return "tag files not found or not readable";
+	db = decide_tag_by_context(dbpath, pattern, path, lineno);
+	if (db == NOTAGS)
+		return "path name in the context is not found";
+	return tagsearch(pattern, db);
 }
 
 /*
@@ -97,10 +556,11 @@ findcalledby(char *pattern)
 char *
 findcalling(char *pattern)
 {
-	snprintf(comline, sizeof(comline), "%s -r %s > %s", common(), quote_shell(pattern), temp1);
-	if (system(comline) != 0)
-		return FAILED;
-	return NULL;
+	char *msg;
+
+	if ((msg = findopen()) != NULL)
+		return msg;
+	return tagsearch(pattern, GRTAGS);
 }
 
 /*
@@ -111,10 +571,11 @@ findcalling(char *pattern)
 char *
 findstring(char *pattern)
 {
-	snprintf(comline, sizeof(comline), "%s -g --literal %s > %s", common(), quote_shell(pattern), temp1);
-	if (system(comline) != 0)
-		return FAILED;
-	return NULL;
+	char *msg;
+
+	if ((msg = findopen()) != NULL)
+		return msg;
+	return grepsearch(pattern, 1, 0);
 }
 
 /*
@@ -130,10 +591,11 @@ findstring(char *pattern)
 char *
 findregexp(char *pattern)
 {
-	snprintf(comline, sizeof(comline), "%s -g %s > %s", common(), quote_shell(pattern), temp1);
-	if (system(comline) != 0)
-		return FAILED;
-	return NULL;
+	char *msg;
+
+	if ((msg = findopen()) != NULL)
+		return msg;
+	return grepsearch(pattern, 0, 0);
 }
 
 /*
@@ -144,9 +606,40 @@ findregexp(char *pattern)
 char *
 findfile(char *pattern)
 {
-	snprintf(comline, sizeof(comline), "%s -P %s > %s", common(), quote_shell(pattern), temp1);
-	if (system(comline) != 0)
-		return FAILED;
+	char edit[IDENTLEN];
+	const char *path;
+	char *msg;
+	int flags = REG_EXTENDED;
+
+	if ((msg = findopen()) != NULL)
+		return msg;
+	if (caseless == YES || getconfb("icase_path"))
+		flags |= REG_ICASE;
+#if defined(_WIN32) || defined(__DJGPP__)
+	else
+		flags |= REG_ICASE;
+#endif
+	/*
+	 * We assume '^aaa' as '^/aaa'.
+	 */
+	if (*pattern == '^' && *(pattern + 1) != '/') {
+		snprintf(edit, sizeof(edit), "^/%s", pattern + 1);
+		pattern = edit;
+	}
+	if (regcomp(&preg, pattern, flags) != 0)
+		return "invalid regular expression";
+	preg_used = 1;
+	if (!tags_usable(GPATH))
+		return "tag files not found or not readable";
+	gp = gfind_open(dbpath, NULL, GPATH_SOURCE, 0);
+	while ((path = gfind_read(gp)) != NULL) {
+		/*
+		 * skip './' except for the last '/' because end-user doesn't see it.
+		 */
+		if (regexec(&preg, path + 1, 0, 0, 0) == 0)
+			putline("path", root, path, 1, "", 0);
+	}
+	cleanup();
 	return NULL;
 }
 
@@ -158,16 +651,16 @@ findfile(char *pattern)
 char *
 findinclude(char *pattern)
 {
-#if defined(_WIN32) && !defined(__CYGWIN__)
-#define INCLUDE "\"^[ \t]*#[ \t]*include[ \t].*[<\\\"/\\]%s[\\\">]\""
-#elif defined(__DJGPP__)
-#define INCLUDE "'^[ \t]*#[ \t]*include[ \t].*[\"</\\]%s[\">]'"
+#if defined(_WIN32) || defined(__DJGPP__)
+#define INCLUDE "^[ \t]*#[ \t]*include[ \t].*[\"</\\]%s[\">]"
 #else
-#define INCLUDE "'^[ \t]*#[ \t]*include[ \t].*[\"</]%s[\">]'"
+#define INCLUDE "^[ \t]*#[ \t]*include[ \t].*[\"</]%s[\">]"
 #endif
-	snprintf(comline, sizeof(comline), "%s -g " INCLUDE " | sed \"s/<unknown>/<global>/\" > %s",
-		common(), quote_string(pattern), temp1);
-	if (system(comline) != 0)
-		return FAILED;
-	return NULL;
+	char regexp[IDENTLEN];
+	char *msg;
+
+	if ((msg = findopen()) != NULL)
+		return msg;
+	snprintf(regexp, sizeof(regexp), INCLUDE, quote_string(pattern));
+	return grepsearch(regexp, 0, 1);
 }
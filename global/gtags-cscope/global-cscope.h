@@ -296,6 +296,7 @@ void	editref(int);
 void	entercurses(void);
 void	exitcurses(void);
 void	findcleanup(void);
+void	findclose(void);
 void    freesrclist(void);
 void    freeinclist(void);
 void    freecrossref(void);
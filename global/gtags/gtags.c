@@ -73,9 +73,11 @@ int main(int, char **);
 int incremental(const char *, const char *);
 void updatetags(const char *, const char *, IDSET *, STRBUF *);
 void createtags(const char *, const char *);
+void compactfids(const char *);
 int printconf(const char *);
 
 int cflag;					/**< compact format */
+int compact_fids;				/**< renumber file ids */
 int iflag;					/**< incremental update */
 int Iflag;					/**< make  idutils index */
 int Oflag;					/**< use objdir */
@@ -150,6 +152,7 @@ static struct option const long_options[] = {
 #define OPT_SKIP_UNREADABLE	134
 	/* flag value */
 	{"accept-dotfiles", no_argument, NULL, OPT_ACCEPT_DOTFILES},
+	{"compact-fids", no_argument, &compact_fids, 1},
 	{"debug", no_argument, &debug, 1},
 	{"explain", no_argument, &explain, 1},
 #ifdef USE_SQLITE3
@@ -411,7 +414,7 @@ main(int argc, char **argv)
 	 * at one of the candidate directories then gtags use existing
 	 * tag files.
 	 */
-	if (iflag) {
+	if (iflag || compact_fids) {
 		if (argc > 0)
 			realpath(*argv, dbpath);
 		else if (!gtagsexist(cwd, dbpath, MAXPATHLEN, vflag))
@@ -437,6 +440,20 @@ main(int argc, char **argv)
 	}
 	if (!test("d", dbpath))
 		die("directory '%s' not found.", dbpath);
+	/*
+	 * Renumber file ids of existing tag files (--compact-fids).
+	 */
+	if (compact_fids) {
+		if (!test("f", makepath(dbpath, dbname(GTAGS), NULL)) ||
+			!test("f", makepath(dbpath, dbname(GRTAGS), NULL)) ||
+			!test("f", makepath(dbpath, dbname(GPATH), NULL)))
+			die("GTAGS, GRTAGS or GPATH not found.");
+		init_statistics();
+		compactfids(dbpath);
+		if (statistics)
+			print_statistics(statistics);
+		exit(0);
+	}
 	/*
 	 * Start processing.
 	 */
@@ -775,35 +792,49 @@ struct put_func_data {
 	GTOP *gtop[GTAGLIM];
 	const char *fid;
 };
-static void
-put_syms(int type, const char *tag, int lno, const char *path, const char *line_image, void *arg)
+/**
+ * valid_symbol: sanity checks of a symbol name
+ *
+ *	@param[in]	tag	symbol name
+ *	@param[in]	lno	line number (for warning message)
+ *	@param[in]	path	path name (for warning message)
+ *	@return		1: valid, 0: invalid
+ *
+ * These checks are required, because there is no telling what kind of string
+ * comes as 'a symbol' from external plug-in parsers.
+ */
+static int
+valid_symbol(const char *tag, int lno, const char *path)
 {
-	const struct put_func_data *data = arg;
-	GTOP *gtop;
 	const char *p;
 
-	/*
-	 * sanity checks
-	 * These checks are required, because there is no telling what kind of string
-	 * comes as 'a symbol' from external plug-in parsers.
-	 */
 	for (p = tag; *p; p++) {
 		if (isspace(*p)) {
 			if (wflag)
 				warning("symbol name includs a space character. (Ignored) [+%d %s]", lno, path);
-			return;
+			return 0;
 		}
 	}
 	if (p == tag) {
 		if (wflag)
 			warning("symbol name is null. (Ignored) [+%d %s]", lno, path);
-		return;
+		return 0;
 	}
 	if (p - tag >= IDENTLEN) {
 		if (wflag)
 			warning("symbol name is too long. (Ignored) [+%d %s]", lno, path);
-		return;
+		return 0;
 	}
+	return 1;
+}
+static void
+put_syms(int type, const char *tag, int lno, const char *path, const char *line_image, void *arg)
+{
+	const struct put_func_data *data = arg;
+	GTOP *gtop;
+
+	if (!valid_symbol(tag, lno, path))
+		return;
 	switch (type) {
 	case PARSER_DEF:
 		gtop = data->gtop[GTAGS];
@@ -818,6 +849,37 @@ put_syms(int type, const char *tag, int lno, const char *path, const char *line_
 	}
 	gtags_put_using(gtop, tag, lno, data->fid, line_image);
 }
+/**
+ * put_syms_batch: put an array of symbols given by a plug-in parser.
+ *
+ *	@param[in]	tags	array of symbols
+ *	@param[in]	count	number of symbols
+ *	@param[in]	path	path name
+ *	@param[in]	arg	put_func_data
+ */
+static void
+put_syms_batch(const struct parser_tag *tags, int count, const char *path, void *arg)
+{
+	const struct put_func_data *data = arg;
+	GTOP *gtags = data->gtop[GTAGS];
+	GTOP *grtags = data->gtop[GRTAGS];
+	const struct parser_tag *t, *end = tags + count;
+
+	for (t = tags; t < end; t++) {
+		GTOP *gtop;
+
+		if (!valid_symbol(t->tag, t->lineno, path))
+			continue;
+		if (t->type == PARSER_DEF)
+			gtop = gtags;
+		else if (t->type == PARSER_REF_SYM)
+			gtop = grtags;
+		else
+			continue;
+		if (gtop != NULL)
+			gtags_put_using(gtop, t->tag, t->lineno, data->fid, t->image);
+	}
+}
 /**
  * updatetags: update tag file.
  *
@@ -895,13 +957,13 @@ updatetags(const char *dbpath, const char *root, IDSET *deleteset, STRBUF *addli
 	end = start + strbuf_getlen(addlist);
 	seqno = 0;
 	for (path = start; path < end; path += strlen(path) + 1) {
-		gpath_put(path, GPATH_SOURCE);
+		gpath_putstamp(path, time(NULL));
 		data.fid = gpath_path2fid(path, NULL);
 		if (data.fid == NULL)
 			die("GPATH is corrupted.('%s' not found)", path);
 		if (vflag)
 			fprintf(stderr, " [%d/%d] extracting tags of %s\n", ++seqno, total, path + 2);
-		parse_file(path, flags, put_syms, &data);
+		parse_file_batch(path, flags, put_syms, put_syms_batch, &data);
 		gtags_flush(data.gtop[GTAGS], data.fid);
 		if (data.gtop[GRTAGS] != NULL)
 			gtags_flush(data.gtop[GRTAGS], data.fid);
@@ -966,14 +1028,14 @@ createtags(const char *dbpath, const char *root)
 				gpath_put(path, GPATH_OTHER);
 			continue;
 		}
-		gpath_put(path, GPATH_SOURCE);
+		gpath_putstamp(path, time(NULL));
 		data.fid = gpath_path2fid(path, NULL);
 		if (data.fid == NULL)
 			die("GPATH is corrupted.('%s' not found)", path);
 		seqno++;
 		if (vflag)
 			fprintf(stderr, " [%d] extracting tags of %s\n", seqno, path + 2);
-		parse_file(path, flags, put_syms, &data);
+		parse_file_batch(path, flags, put_syms, put_syms_batch, &data);
 		gtags_flush(data.gtop[GTAGS], data.fid);
 		gtags_flush(data.gtop[GRTAGS], data.fid);
 	}
@@ -1001,6 +1063,137 @@ createtags(const char *dbpath, const char *root)
 	}
 	strbuf_close(sb);
 }
+/**
+ * compactfids: renumber file ids densely in the order of path names.
+ *
+ *	@param[in]	dbpath	dbpath directory
+ *
+ * Incremental updating leaves holes in file ids of deleted files and
+ * gives new files the largest ids. This rewrites GPATH and the tag files
+ * into temporary files in one sequential pass each, and replaces them
+ * at the end. The modification times are kept so that the next
+ * incremental updating works as usual.
+ */
+void
+compactfids(const char *dbpath)
+{
+	STATISTICS_TIME *tim;
+	STRBUF *sb = strbuf_open(0);
+	char tmpname[GTAGLIM][MAXPATHLEN];
+	char fid[MAXFIDLEN];
+	DBOP *old, *new;
+	const char *dat, *key, *flag, *p;
+	int *newfid;
+	int db, id, nextkey, count = 0;
+
+	tim = statistics_time_start("Time of compacting file ids.");
+	if (vflag)
+		fprintf(stderr, "[%s] Compacting file ids.\n", now());
+	/*
+	 * GPATH
+	 *
+	 * In the order of keys, path name records ("./...") precede
+	 * file id records, so new ids are given in the order of path names.
+	 */
+	if ((old = dbop_open(makepath(dbpath, dbname(GPATH), NULL), 0, 0, DBOP_RAW)) == NULL)
+		die("GPATH not found.");
+	if ((dat = dbop_get(old, NEXTKEY)) == NULL)
+		die("nextkey not found in GPATH.");
+	nextkey = atoi(dat);
+	newfid = (int *)check_calloc(sizeof(int), nextkey);
+	strlimcpy(tmpname[GPATH], makepath(dbpath, dbname(GPATH), "tmp"), MAXPATHLEN);
+	if ((new = dbop_open(tmpname[GPATH], 1, 0644, 0)) == NULL)
+		die("cannot make '%s'.", tmpname[GPATH]);
+	for (dat = dbop_first(old, NULL, NULL, 0); dat != NULL; dat = dbop_next(old)) {
+		key = old->lastkey;
+		if (*key == ' ') {
+			/* meta records except for NEXTKEY */
+			if (strcmp(key, NEXTKEY))
+				dbop_put(new, key, dat);
+			continue;
+		}
+		if (*key != '.')
+			continue;	/* file id records are made again */
+		id = atoi(dat);
+		if (id <= 0 || id >= nextkey)
+			die("GPATH is corrupted. (file id '%s' of '%s')", dat, key);
+		flag = dbop_getflag(old);
+		newfid[id] = ++count;
+		snprintf(fid, sizeof(fid), "%d", count);
+		dbop_put_path(new, key, fid, *flag ? flag : NULL);
+		/* the stamp of a source file is kept only in the path name record */
+		dbop_put_path(new, fid, key, *flag == 'o' ? flag : NULL);
+	}
+	snprintf(fid, sizeof(fid), "%d", count + 1);
+	dbop_update(new, NEXTKEY, fid);
+	dbop_close(new);
+	dbop_close(old);
+	if (vflag)
+		fprintf(stderr, " %d files, file ids 1-%d (previously up to %d).\n", count, count, nextkey - 1);
+	/*
+	 * GTAGS, GRTAGS (and GSYMS if exists)
+	 *
+	 * Each record begins with the file id:
+	 * <file id> <tag name> ...
+	 * Records of unknown files are dropped.
+	 */
+	for (db = GTAGS; db < GTAGLIM; db++) {
+		tmpname[db][0] = '\0';
+		if (!test("f", makepath(dbpath, dbname(db), NULL)))
+			continue;
+		if (vflag)
+			fprintf(stderr, " Rewriting '%s'.\n", dbname(db));
+		if ((old = dbop_open(makepath(dbpath, dbname(db), NULL), 0, 0, DBOP_RAW)) == NULL)
+			die("%s not found.", dbname(db));
+		strlimcpy(tmpname[db], makepath(dbpath, dbname(db), "tmp"), MAXPATHLEN);
+#ifdef USE_SQLITE3
+		new = dbop_open(tmpname[db], 1, 0644, DBOP_DUP | (old->openflags & DBOP_SQLITE3));
+#else
+		new = dbop_open(tmpname[db], 1, 0644, DBOP_DUP);
+#endif
+		if (new == NULL)
+			die("cannot make '%s'.", tmpname[db]);
+		for (dat = dbop_first(old, NULL, NULL, 0); dat != NULL; dat = dbop_next(old)) {
+			key = old->lastkey;
+			if (*key == ' ') {
+				dbop_put(new, key, dat);
+				continue;
+			}
+			for (id = 0, p = dat; isdigit((unsigned char)*p); p++)
+				id = id * 10 + (*p - '0');
+			if (id <= 0 || id >= nextkey || newfid[id] == 0)
+				continue;
+			strbuf_reset(sb);
+			strbuf_putn(sb, newfid[id]);
+			strbuf_puts(sb, p);
+			dbop_put_tag(new, key, strbuf_value(sb));
+		}
+		dbop_close(new);
+		dbop_close(old);
+	}
+	/*
+	 * Replace the tag files keeping their modification times.
+	 */
+	for (db = GPATH; db < GTAGLIM; db++) {
+		const char *path;
+		struct stat statp;
+		struct utimbuf times;
+
+		if (db != GPATH && tmpname[db][0] == '\0')
+			continue;
+		path = makepath(dbpath, dbname(db), NULL);
+		if (stat(path, &statp) < 0)
+			die("stat failed '%s'.", path);
+		times.actime = statp.st_atime;
+		times.modtime = statp.st_mtime;
+		if (rename(tmpname[db], path) < 0)
+			die("cannot replace '%s'.", path);
+		utime(path, &times);
+	}
+	free(newfid);
+	strbuf_close(sb);
+	statistics_time_end(tim);
+}
 /**
  * printconf: print configuration data.
  *
@@ -37,7 +37,7 @@
 #include "htags.h"
 #include "path2url.h"
 
-static XARGS *anchor_input[GTAGLIM];
+static DBOP *anchor_input;
 static struct anchor *table;
 static VARRAY *vb;
 
@@ -46,11 +46,29 @@ static struct anchor *curp;
 static struct anchor *end;
 static struct anchor *CURRENT;
 
+/** order of tag files: GTAGS ('D', 'M', 'T'), GRTAGS ('R'), GSYMS ('Y') */
+#define typeorder(type)	((type) == 'R' ? 1 : (type) == 'Y' ? 2 : 0)
 /** compare routine for qsort(3) */
 static int
 cmp(const void *s1, const void *s2)
 {
-	return ((struct anchor *)s1)->lineno - ((struct anchor *)s2)->lineno;
+	const struct anchor *a1 = (const struct anchor *)s1;
+	const struct anchor *a2 = (const struct anchor *)s2;
+
+	if (a1->lineno != a2->lineno)
+		return a1->lineno - a2->lineno;
+	return typeorder(a1->type) - typeorder(a2->type);
+}
+/** compare routine for the anchors of a tag file in a line */
+static int
+cmp_column(const void *s1, const void *s2)
+{
+	const struct anchor *a1 = (const struct anchor *)s1;
+	const struct anchor *a2 = (const struct anchor *)s2;
+
+	if (a1->column != a2->column)
+		return a1->column - a2->column;
+	return strcmp(gettag(a1), gettag(a2));
 }
 /*
  * Pointers (as lineno).
@@ -59,43 +77,216 @@ static int FIRST;
 static int LAST;
 static struct anchor *CURRENTDEF;
 
+/**
+ * decide_type: decide the type of a definition by the line image.
+ *
+ *	@param[in]	tag	tag name
+ *	@param[in]	image	line image
+ *	@return		'D': function, 'M': macro, 'T': type
+ *
+ * Function header is applied only to the anchor whoes type is 'D'.
+ */
+static int
+decide_type(const char *tag, const char *image)
+{
+	const char *p = image;
+
+	for (; *p && isspace((unsigned char)*p); p++)
+		;
+	if (*p == '#')
+		return 'M';
+	if (locatestring(p, "typedef", MATCH_AT_FIRST))
+		return 'T';
+	if ((p = locatestring(p, tag, MATCH_FIRST)) != NULL) {
+		/* skip a tag and the following blanks */
+		p += strlen(tag);
+		for (; *p && isspace((unsigned char)*p); p++)
+			;
+		if (*p == '(')
+			return 'D';
+	}
+	return 'T';
+}
+/**
+ * put_anchor: put an anchor record into the anchor input.
+ *
+ *	@param[in]	fid	file id
+ *	@param[in]	lineno	line number
+ *	@param[in]	type	anchor type ('?': not decided yet)
+ *	@param[in]	tag	tag name
+ *
+ * anchor record: <line number> <type> <tag name>
+ */
+static void
+put_anchor(const char *fid, int lineno, int type, const char *tag)
+{
+	STATIC_STRBUF(sb);
+
+	strbuf_clear(sb);
+	strbuf_putn(sb, lineno);
+	strbuf_putc(sb, ' ');
+	strbuf_putc(sb, type);
+	strbuf_putc(sb, ' ');
+	strbuf_puts(sb, tag);
+	dbop_put(anchor_input, fid, strbuf_value(sb));
+}
+/**
+ * load_tags: load anchors of the files from a tag file.
+ *
+ *	@param[in]	db	GTAGS or GRTAGS (including GSYMS)
+ *	@param[in]	fids	file ids of the files
+ */
+static void
+load_tags(int db, IDSET *fids)
+{
+	GTOP *gtop = gtags_open(dbpath, cwdpath, db, GTAGS_READ, 0);
+	const char *tagline;
+	char fid[MAXFIDLEN];
+	char prev_name[MAXTOKEN+1];
+	int defined = 0;
+
+	prev_name[0] = '\0';
+	/*
+	 * Read records directly instead of using gtags_first(); we need
+	 * neither sorting nor the path name of each record.
+	 *
+	 * Standard format: <file id> <tag name> <line number> <line image>
+	 * Compact format:  <file id> <tag name> <line number>,...
+	 */
+	for (tagline = dbop_first(gtop->dbop, NULL, NULL, 0); tagline; tagline = dbop_next(gtop->dbop)) {
+		const char *tag = gtop->dbop->lastkey;
+		const char *p = tagline;
+		int n = 0, type;
+
+		for (n = 0; isdigit(*p); p++)
+			n = n * 10 + (*p - '0');
+		if (*p != ' ')
+			die("invalid tag record. '%s'", tagline);
+		if (!idset_contains(fids, n))
+			continue;
+		snprintf(fid, sizeof(fid), "%d", n);
+		/* skip the tag name */
+		for (p++; *p && *p != ' '; p++)
+			;
+		if (*p++ != ' ' || !isdigit(*p))
+			die("invalid tag record. '%s'", tagline);
+		if (db != GTAGS && strcmp(tag, prev_name)) {
+			/* records are sorted by the tag name */
+			strlimcpy(prev_name, tag, sizeof(prev_name));
+			defined = dbop_get(gtop->gtags, prev_name) != NULL;
+		}
+		if (db == GTAGS)
+			type = '?';
+		else if (defined)
+			type = gtags_exist[GRTAGS] ? 'R' : 0;
+		else
+			type = gtags_exist[GSYMS] ? 'Y' : 0;
+		if (type == 0)
+			continue;
+		if (!(gtop->format & GTAGS_COMPACT)) {
+			for (n = 0; isdigit(*p); p++)
+				n = n * 10 + (*p - '0');
+			if (db == GTAGS) {
+				const char *image = (*p == ' ') ? p + 1 : "";
+
+				if (gtop->format & GTAGS_COMPRESS)
+					image = uncompress(image, tag);
+				type = decide_type(tag, image);
+			}
+			put_anchor(fid, n, type, tag);
+		} else {
+			LNOLIST l;
+
+			lnolist_open(&l, p, gtop->format & GTAGS_COMPLINE);
+			while ((n = lnolist_next(&l)) > 0)
+				put_anchor(fid, n, type, tag);
+		}
+	}
+	gtags_close(gtop);
+}
 /**
  * anchor_prepare: setup input stream.
  *
  *	@param[in]	anchor_stream	file pointer of path list
+ *
+ * Anchors of the files in the list are read from GTAGS and GRTAGS
+ * with one pass for each, and are stored into a temporary database
+ * keyed by the file id. Anchor_load() reads the records of a file from it.
  */
 void
 anchor_prepare(FILE *anchor_stream)
 {
-	/*
-	 * Option table:
-	 * We use blank string as null option instead of null string("")
-	 * not to change the command length. This length influences
-	 * the number of arguments in the xargs processing.
-	 */
-	static const char *const options[] = {NULL, " ", "r", "s"};
-	char comline[MAXFILLEN];
-	int db;
+	STRBUF *sb = strbuf_open(0);
+	IDSET *fids;
+	const char *path;
 
-	for (db = GTAGS; db < GTAGLIM; db++) {
-		anchor_input[db] = NULL;
-		/*
-		 * Htags(1) should not use gtags-parser(1) directly;
-		 * it should use global(1) with the -f option instead.
-		 * Because gtags-parser is part of the implementation of
-		 * gtags(1) and global(1), and htags is only an application
-		 * program which uses global(1). If htags depends on
-		 * gtags-parser, it will become difficult to change the
-		 * implementation of gtags and global.
-		 *
-		 * Though the output of global -f is not necessarily sorted
-		 * by the path, it is guaranteed that the records concerning
-		 * the same file are consecutive.
-		 */
-		if (gtags_exist[db] == 1) {
-			snprintf(comline, sizeof(comline), "%s -f%s --encode-path=\" \t\" --result=ctags-xid --nofilter=path", quote_shell(global_path), options[db]);
-			anchor_input[db] = xargs_open_with_file(comline, 0, anchor_stream);
-		}
+	if (gpath_open(dbpath, 0) < 0)
+		die("GPATH not found.");
+	fids = idset_open(gpath_nextkey());
+	gpath_close();
+	rewind(anchor_stream);
+	while ((path = strbuf_fgets(sb, anchor_stream, STRBUF_NOCRLF)) != NULL) {
+		/* other files don't have anchors */
+		if (*path == ' ')
+			continue;
+		idset_add(fids, atoi(path2fid(path)));
+	}
+	strbuf_close(sb);
+	anchor_input = dbop_open(NULL, 1, 0600, DBOP_DUP);
+	if (anchor_input == NULL)
+		die("cannot make temporary file in anchor_prepare().");
+	if (!idset_empty(fids)) {
+		if (gtags_exist[GTAGS] == 1)
+			load_tags(GTAGS, fids);
+		if (gtags_exist[GRTAGS] == 1 || gtags_exist[GSYMS] == 1)
+			load_tags(GRTAGS, fids);
+	}
+	idset_close(fids);
+}
+/**
+ * anchor_dup: replace the input stream with a private copy.
+ *
+ *	@param[in]	anchor_stream	file pointer of path list
+ *
+ * A child process calls this so that it does not share the file offset
+ * of the temporary database with other processes. Only the anchors of
+ * the files in the list are copied.
+ */
+void
+anchor_dup(FILE *anchor_stream)
+{
+	STRBUF *sb = strbuf_open(0);
+	DBOP *new;
+	const char *path, *record;
+	char fid[MAXFIDLEN];
+
+	if (anchor_input == NULL)
+		die("anchor_dup: internal error. anchor input is not prepared.");
+	new = dbop_open(NULL, 1, 0600, DBOP_DUP);
+	if (new == NULL)
+		die("cannot make temporary file in anchor_dup().");
+	rewind(anchor_stream);
+	while ((path = strbuf_fgets(sb, anchor_stream, STRBUF_NOCRLF)) != NULL) {
+		/* other files don't have anchors */
+		if (*path == ' ')
+			continue;
+		strlimcpy(fid, path2fid(path), sizeof(fid));
+		for (record = dbop_first(anchor_input, fid, NULL, 0); record; record = dbop_next(anchor_input))
+			dbop_put(new, fid, record);
+	}
+	strbuf_close(sb);
+	dbop_close(anchor_input);
+	anchor_input = new;
+}
+/**
+ * anchor_close: close input stream.
+ */
+void
+anchor_close(void)
+{
+	if (anchor_input) {
+		dbop_close(anchor_input);
+		anchor_input = NULL;
 	}
 }
 /**
@@ -106,15 +297,14 @@ anchor_prepare(FILE *anchor_stream)
 void
 anchor_load(const char *path)
 {
-	int db, current_fid;
+	struct anchor *a;
+	const char *fid, *record;
+	int undecided = 0;
 
 	/* Get fid of the path */
-	{
-		const char *p = path2fid(path);
-		if (p == NULL)
-			die("anchor_load: internal error. file '%s' not found in GPATH.", path);
-		current_fid = atoi(p);
-	}
+	fid = path2fid(path);
+	if (fid == NULL)
+		die("anchor_load: internal error. file '%s' not found in GPATH.", path);
 	FIRST = LAST = 0;
 	end = CURRENT = NULL;
 
@@ -123,85 +313,72 @@ anchor_load(const char *path)
 	else
 		varray_reset(vb);
 
-	for (db = GTAGS; db < GTAGLIM; db++) {
-		XARGS *xp;
-		char *ctags_xid;
+	if (anchor_input == NULL)
+		die("anchor_load: internal error. anchor input is not prepared.");
+	for (record = dbop_first(anchor_input, fid, NULL, 0); record; record = dbop_next(anchor_input)) {
+		const char *p = record;
+		int lineno;
 
-		if ((xp = anchor_input[db]) == NULL)
-			continue;
 		/*
-		 * Read from input stream until it reaches end of file
-		 * or the line of another file appears.
+		 * anchor record: <line number> <type> <tag name>
 		 */
-		while ((ctags_xid = xargs_read(xp)) != NULL) {
-			SPLIT ptable;
-			struct anchor *a;
-			int type, fid;
-			const char *ctags_x = parse_xid(ctags_xid, NULL, &fid);
-
-			/*
-			 * It is the following file.
-			 */
-			if (current_fid != fid) {
-				xargs_unread(xp);
-				break;
-			}
-			if (split(ctags_x, 4, &ptable) < 4) {
-				recover(&ptable);
-				die("too small number of parts in anchor_load().\n'%s'", ctags_x);
-			}
-			if (db == GTAGS) {
-				char *p = ptable.part[PART_LINE].start;
-
-				for (; *p && isspace((unsigned char)*p); p++)
-					;
-				if (!*p) {
-					recover(&ptable);
-					die("The output of parser is invalid.\n%s", ctags_x);
-				}
-				/*
-				 * Function header is applied only to the anchor whoes type is 'D'.
-				 * (D: function, M: macro, T: type)
-				 */
-				type = 'T';
-				if (*p == '#')
-					type = 'M';
-				else if (locatestring(p, "typedef", MATCH_AT_FIRST))
-					type = 'T';
-				else if ((p = locatestring(p, ptable.part[PART_TAG].start, MATCH_FIRST)) != NULL) {
-					/* skip a tag and the following blanks */
-					p += strlen(ptable.part[PART_TAG].start);
-					for (; *p && isspace((unsigned char)*p); p++)
-						;
-					if (*p == '(')
-						type = 'D';
-				}
-			}  else if (db == GRTAGS)
-				type = 'R';
-			else
-				type = 'Y';
-			/* allocate an entry */
-			a = varray_append(vb);
-			a->lineno = atoi(ptable.part[PART_LNO].start);
-			a->type = type;
-			a->done = 0;
-			settag(a, ptable.part[PART_TAG].start);
-			recover(&ptable);
-		}
-		if (ctags_xid == NULL) {
-			xargs_close(anchor_input[db]);
-			anchor_input[db] = NULL;
-		}
+		for (lineno = 0; isdigit((unsigned char)*p); p++)
+			lineno = lineno * 10 + (*p - '0');
+		if (p[0] != ' ' || p[1] == '\0' || p[2] != ' ')
+			die("anchor_load: internal error. invalid record '%s'.", record);
+		/* allocate an entry */
+		a = varray_append(vb);
+		a->lineno = lineno;
+		a->type = p[1];
+		a->done = 0;
+		a->column = 0;
+		settag(a, (char *)p + 3);
+		if (a->type == '?')
+			undecided = 1;
 	}
 	if (vb->length == 0) {
 		table = NULL;
 	} else {
-		int i, used = vb->length;
+		SRCLINE *srcline = NULL;
+		int i, j, used = vb->length;
 		/*
-		 * Sort by lineno.
+		 * Sort by lineno and tag file.
 		 */
 		table = varray_assign(vb, 0, 0);
 		qsort(table, used, sizeof(struct anchor), cmp); 
+		for (i = 0; i < used; i = j) {
+			const char *image = NULL;
+
+			for (j = i + 1; j < used && !cmp(&table[i], &table[j]); j++)
+				;
+			/*
+			 * The type of a definition is decided by its line image,
+			 * which isn't stored in GTAGS of the compact format.
+			 */
+			if (undecided && table[i].type == '?') {
+				if (srcline == NULL)
+					srcline = srcline_open(cwdpath, 0);
+				image = srcline_get(srcline, path, table[i].lineno);
+				for (a = &table[i]; a < &table[j]; a++)
+					if (a->type == '?')
+						a->type = decide_type(gettag(a), image);
+			}
+			/*
+			 * The anchors of a tag file in a line are sorted by
+			 * the column like the output of the parser.
+			 */
+			if (j - i > 1) {
+				if (srcline == NULL)
+					srcline = srcline_open(cwdpath, 0);
+				if (image == NULL)
+					image = srcline_get(srcline, path, table[i].lineno);
+				for (a = &table[i]; a < &table[j]; a++)
+					a->column = srcline_column(image, gettag(a));
+				qsort(&table[i], j - i, sizeof(struct anchor), cmp_column);
+			}
+		}
+		if (srcline)
+			srcline_close(srcline);
 		/*
 		 * Setup some lineno.
 		 */
@@ -283,6 +460,7 @@ struct anchor *
 anchor_get(const char *name, int length, int type, int lineno)
 {
 	struct anchor *p = curp ? curp : start;
+	struct anchor *used = NULL;
 
 	if (table == NULL)
 		return NULL;
@@ -297,10 +475,18 @@ anchor_get(const char *name, int length, int type, int lineno)
 		return NULL;
 	curp = p;
 	for (; p < end && p->lineno == lineno; p++)
-		if (!p->done && p->length == length && !strcmp(gettag(p), name))
-			if (!type || p->type == type)
-				return p;
-	return NULL;
+		if (p->length == length && !strcmp(gettag(p), name))
+			if (!type || p->type == type) {
+				if (!p->done)
+					return p;
+				if (p->type == 'R' || p->type == 'Y')
+					used = p;
+			}
+	/*
+	 * Tag files have only one record for a reference in a line,
+	 * though the name may appear in the line more than once.
+	 */
+	return used;
 }
 /**
  * define_line: check whether or not this is a define line.
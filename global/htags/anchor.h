@@ -33,6 +33,7 @@ struct anchor {
         int lineno;
         char type;
 	char done;
+	int column;
 	int length;
         char tag[ANCHOR_NAMELEN];
 	char *reserve;
@@ -64,7 +65,9 @@ struct anchor {
 #define A_LIMIT		8
 
 void anchor_prepare(FILE *);
+void anchor_dup(FILE *);
 void anchor_load(const char *);
+void anchor_close(void);
 void anchor_unload(void);
 struct anchor *anchor_first(void);
 struct anchor *anchor_next(void);
@@ -93,6 +93,55 @@ cache_get(int db, const char *tag)
 		die("I don't know such tag file.");
 	return assoc_get(assoc[db], tag);
 }
+/**
+ * cache_first: get the first tag in the cache.
+ *
+ *	@param[in]	db	db type
+ *	@param[out]	line	tag line
+ *	@return		tag name, NULL: no more tag
+ *
+ * Tags are returned in the same order as that of the tag file.
+ */
+const char *
+cache_first(int db, const char **line)
+{
+	if (db >= GTAGLIM)
+		die("I don't know such tag file.");
+	return assoc_first(assoc[db], line);
+}
+/**
+ * cache_next: get the next tag in the cache.
+ *
+ *	@param[in]	db	db type
+ *	@param[out]	line	tag line
+ *	@return		tag name, NULL: no more tag
+ */
+const char *
+cache_next(int db, const char **line)
+{
+	if (db >= GTAGLIM)
+		die("I don't know such tag file.");
+	return assoc_next(assoc[db], line);
+}
+/**
+ * cache_dup: replace the cache with a private copy.
+ *
+ * A child process calls this so that it does not share the file offset
+ * of the cache file with other processes.
+ */
+void
+cache_dup(void)
+{
+	int i;
+
+	for (i = GTAGS; i < GTAGLIM; i++) {
+		if (assoc[i]) {
+			ASSOC *new = assoc_dup(assoc[i]);
+			assoc_close(assoc[i]);
+			assoc[i] = new;
+		}
+	}
+}
 /**
  * cache_close: close cache file.
  */
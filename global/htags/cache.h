@@ -22,6 +22,9 @@
 void cache_open(void);
 void cache_put(int, const char *, const char *, int);
 const char *cache_get(int, const char *);
+const char *cache_first(int, const char **);
+const char *cache_next(int, const char **);
+void cache_dup(void);
 void cache_close(void);
 
 #endif /* ! _CACHE_H_ */
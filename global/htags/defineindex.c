@@ -43,7 +43,7 @@
  *	@param[in]	total		definitions total
  *	@param[out]	defines		@defines
  *	Globals used (input):
- *		tag cache	  XXX: should this be global output, not input?
+ *		tag cache	  made by makedupindex()
  */
 int
 makedefineindex(const char *file, int total, STRBUF *defines)
@@ -52,14 +52,14 @@ makedefineindex(const char *file, int total, STRBUF *defines)
 	int alpha_count = 0;
 	FILEOP *fileop_MAP = NULL, *fileop_DEFINES, *fileop_ALPHA = NULL;
 	FILE *MAP = NULL;
-	FILE *DEFINES, *STDOUT, *TAGS, *ALPHA = NULL;
-	STRBUF *sb = strbuf_open(0);
+	FILE *DEFINES, *STDOUT, *ALPHA = NULL;
 	STRBUF *url = strbuf_open(0);
 	/* Index link */
 	const char *target = (Fflag) ? "mains" : "_top";
 	const char *indexlink;
 	const char *index_string = "Index Page";
-	char command[1024], buf[1024], alpha[32], alpha_f[32], *_;
+	const char *tag, *line;
+	char buf[1024], alpha[32], alpha_f[32];
 
 	if (!aflag && !Fflag)
 		indexlink = "mains";
@@ -99,16 +99,14 @@ makedefineindex(const char *file, int total, STRBUF *defines)
 	 * map DEFINES to STDOUT.
 	 */
 	STDOUT = DEFINES;
-	snprintf(command, sizeof(command), PQUOTE "%s -c" PQUOTE, quote_shell(global_path));
-	if ((TAGS = popen(command, "r")) == NULL)
-		die("cannot execute '%s'.", command);
+	/*
+	 * The cache of GTAGS has all the definitions in the order of names.
+	 */
 	alpha[0] = '\0';
-	while ((_ = strbuf_fgets(sb, TAGS, STRBUF_NOCRLF)) != NULL) {
-		const char *tag, *line;
+	for (tag = cache_first(GTAGS, &line); tag; tag = cache_next(GTAGS, &line)) {
 		char guide[1024], url_for_map[1024];
 
 		count++;
-		tag = _;
 		message(" [%d/%d] adding %s", count, total, tag);
 		if (aflag && (alpha[0] == '\0' || !locatestring(tag, alpha, MATCH_AT_FIRST))) {
 			const char *msg = (alpha_count == 1) ? "definition" : "definitions";
@@ -193,11 +191,8 @@ makedefineindex(const char *file, int total, STRBUF *defines)
 		/*
 		 * generating url for function definition.
 	 	 */
-		line = cache_get(GTAGS, tag);
 		strbuf_reset(url);
 
-		if (line == NULL)
-			die("internal error in makedefineindex()."); 
 		/*
 		 * About the format of 'line', please see the head comment of cache.c.
 		 */
@@ -244,8 +239,6 @@ makedefineindex(const char *file, int total, STRBUF *defines)
 		if (map_file)
 			fprintf(MAP, "%s\t%s\n", tag, url_for_map);
 	}
-	if (pclose(TAGS) != 0)
-		die("terminated abnormally '%s' (errno = %d).", command, errno);
 	if (aflag && alpha[0]) {
 		char tmp[128];
 		const char *msg = (alpha_count == 1) ? "definition" : "definitions";
@@ -287,7 +280,6 @@ makedefineindex(const char *file, int total, STRBUF *defines)
 	html_count++;
 	if (map_file)
 		close_file(fileop_MAP);
-	strbuf_close(sb);
 	strbuf_close(url);
 	return count;
 }
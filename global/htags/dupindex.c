@@ -21,7 +21,6 @@
 #include <config.h>
 #endif
 #include <stdio.h>
-#include <errno.h>
 #ifdef HAVE_STRING_H
 #include <string.h>
 #else
@@ -39,7 +38,144 @@
  */
 static const char *dirs[]    = {NULL, DEFS,         REFS,        SYMS};
 static const char *kinds[]   = {NULL, "definition", "reference", "symbol"};
-static const char *options[] = {NULL, "",           "r",         "s"};
+
+/**
+ * make_ctags_x: make a line of ctags -x format.
+ *
+ *	@param[out]	sb	string buffer
+ *	@param[in]	tag	tag name
+ *	@param[in]	lineno	line number
+ *	@param[in]	path	path name
+ *	@param[in]	image	line image
+ *
+ * The format is the same as that of 'global -x --encode-path=" \t"'.
+ */
+static void
+make_ctags_x(STRBUF *sb, const char *tag, int lineno, const char *path, const char *image)
+{
+	static const char hex[] = "0123456789abcdef";
+	int len;
+
+	strbuf_reset(sb);
+	strbuf_sprintf(sb, "%-16s %4d ", tag, lineno);
+	for (len = 0; *path; path++, len++) {
+		if (*path == ' ' || *path == '\t' || *path == '%') {
+			strbuf_putc(sb, '%');
+			strbuf_putc(sb, hex[((unsigned char)*path) / 16]);
+			strbuf_putc(sb, hex[((unsigned char)*path) % 16]);
+			len += 2;
+		} else
+			strbuf_putc(sb, *path);
+	}
+	for (; len < 16; len++)
+		strbuf_putc(sb, ' ');
+	strbuf_putc(sb, ' ');
+	strbuf_puts(sb, image);
+}
+
+/*
+ * Duplicate object index of a tag file.
+ */
+struct dupindex {
+	int db;
+	int count;			/**< number of tags		*/
+	int entry_count;		/**< number of entries of the tag */
+	STRBUF *tag;			/**< current tag		*/
+	STRBUF *first_fid;		/**< file id of the first entry	*/
+	STRBUF *first_line;		/**< ctags -x of the first entry */
+	int first_lineno;		/**< line number of the first entry */
+	STRBUF *line;
+	char srcdir[MAXPATHLEN];
+	FILEOP *fileop;
+	FILE *op;
+};
+/**
+ * flush_tag: settle the current tag.
+ *
+ *	@param[in]	d	duplicate object index
+ *
+ * If the tag has only one entry, the cache record points the entry,
+ * else it points the duplicate entry list.
+ */
+static void
+flush_tag(struct dupindex *d)
+{
+	STATIC_STRBUF(tmp);
+
+	strbuf_clear(tmp);
+	if (d->entry_count > 1) {
+		if (!dynamic) {
+			fputs_nl(gen_list_end(), d->op);
+			fputs_nl(body_end, d->op);
+			fputs_nl(gen_page_end(), d->op);
+			close_file(d->fileop);
+			html_count++;
+		}
+		/*
+		 * cache record: " <fid>\0<entry number>\0"
+		 */
+		strbuf_putc(tmp, ' ');
+		strbuf_putn(tmp, d->count);
+		strbuf_putc(tmp, '\0');
+		strbuf_putn(tmp, d->entry_count);
+	} else {
+		/*
+		 * cache record: "<line number>\0<fid>\0"
+		 */
+		strbuf_putn(tmp, d->first_lineno);
+		strbuf_putc(tmp, '\0');
+		strbuf_puts(tmp, strbuf_value(d->first_fid));
+	}
+	cache_put(d->db, strbuf_value(d->tag), strbuf_value(tmp), strbuf_getlen(tmp) + 1);
+}
+/**
+ * put_entry: put an entry of the tag file.
+ *
+ *	@param[in]	d	duplicate object index
+ *	@param[in]	tag	tag name
+ *	@param[in]	fid	file id
+ *	@param[in]	path	path name
+ *	@param[in]	lineno	line number
+ *	@param[in]	image	line image (NULL: not needed)
+ */
+static void
+put_entry(struct dupindex *d, const char *tag, const char *fid, const char *path, int lineno, const char *image)
+{
+	if (strcmp(strbuf_value(d->tag), tag)) {
+		if (d->count > 0)
+			flush_tag(d);
+		d->count++;
+		if (vflag)
+			fprintf(stderr, " [%d] adding %s %s\n", d->count, kinds[d->db], tag);
+		strbuf_reset(d->tag);
+		strbuf_puts(d->tag, tag);
+		d->entry_count = 0;
+	}
+	d->entry_count++;
+	if (d->entry_count == 1) {
+		strbuf_reset(d->first_fid);
+		strbuf_puts(d->first_fid, fid);
+		d->first_lineno = lineno;
+		if (!dynamic)
+			make_ctags_x(d->first_line, tag, lineno, path, image);
+		return;
+	}
+	if (dynamic)
+		return;
+	if (d->entry_count == 2) {
+		char file[MAXPATHLEN];
+
+		snprintf(file, sizeof(file), "%s/%s/%d.%s", distpath, dirs[d->db], d->count, HTML);
+		d->fileop = open_output_file(file, 0);
+		d->op = get_descripter(d->fileop);
+		fputs_nl(gen_page_begin(tag, SUBDIR), d->op);
+		fputs_nl(body_begin, d->op);
+		fputs_nl(gen_list_begin(), d->op);
+		fputs_nl(gen_list_body(d->srcdir, strbuf_value(d->first_line), strbuf_value(d->first_fid)), d->op);
+	}
+	make_ctags_x(d->line, tag, lineno, path, image);
+	fputs_nl(gen_list_body(d->srcdir, strbuf_value(d->line), fid), d->op);
+}
 
 /**
  * Make duplicate object index.
@@ -47,168 +183,82 @@ static const char *options[] = {NULL, "",           "r",         "s"};
  * If referred tag is only one, direct link which points the tag is generated.
  * Else if two or more tag exists, indirect link which points the tag list
  * is generated.
+ *
+ * The tag files are read directly, and the tag cache is made at the same
+ * time. The cache of GTAGS is used as the list of definitions by
+ * makedefineindex().
  */
 int
 makedupindex(void)
 {
-	STRBUF *sb = strbuf_open(0);
-	STRBUF *tmp = strbuf_open(0);
-	STRBUF *command = strbuf_open(0);
+	struct dupindex d;
+	SRCLINE *srcline = srcline_open(cwdpath, SRCLINE_WARNING);
 	int definition_count = 0;
-	char srcdir[MAXPATHLEN];
-	int db;
-	FILEOP *fileop = NULL;
-	FILE *op = NULL;
-	FILE *ip = NULL;
 
-	snprintf(srcdir, sizeof(srcdir), "../%s", SRCS);
-	for (db = GTAGS; db < GTAGLIM; db++) {
-		const char *kind = kinds[db];
-		const char *option = options[db];
-		int writing = 0;
-		int count = 0;
-		int entry_count = 0;
-		const char *ctags_xid, *ctags_x;
-		char tag[IDENTLEN], prev[IDENTLEN], first_line[MAXBUFLEN];
+	d.tag = strbuf_open(0);
+	d.first_fid = strbuf_open(0);
+	d.first_line = strbuf_open(0);
+	d.line = strbuf_open(0);
+	snprintf(d.srcdir, sizeof(d.srcdir), "../%s", SRCS);
+	for (d.db = GTAGS; d.db < GTAGLIM; d.db++) {
+		GTOP *gtop;
+		GTP *gtp;
+		int flags = 0;
 
-		if (gtags_exist[db] == 0)
+		if (gtags_exist[d.db] == 0)
 			continue;
-		prev[0] = 0;
-		first_line[0] = 0;
-		/*
-		 * construct command line.
-		 */
-		strbuf_reset(command);
-#if defined(_WIN32) && !defined(__CYGWIN__)
-		strbuf_putc(command, '"');
-#endif
-		strbuf_sprintf(command, "%s -x%s --result=ctags-xid --encode-path=\" \t\" --nofilter=path", quote_shell(global_path), option);
+		d.count = d.entry_count = 0;
+		strbuf_reset(d.tag);
 		/*
 		 * Optimization when the --dynamic option is specified.
 		 */
-		if (dynamic) {
-			strbuf_puts(command, " --nosource");
-			if (db != GSYMS)
-				strbuf_puts(command, " --nofilter=sort");
-		}
-		strbuf_puts(command, " \".*\"");
-#if defined(_WIN32) && !defined(__CYGWIN__)
-		strbuf_putc(command, '"');
-#endif
-		if ((ip = popen(strbuf_value(command), "r")) == NULL)
-			die("cannot execute '%s'.", strbuf_value(command));
-		while ((ctags_xid = strbuf_fgets(sb, ip, STRBUF_NOCRLF)) != NULL) {
+		if (dynamic && d.db != GSYMS)
+			flags |= GTOP_NOSORT;
+		gtop = gtags_open(dbpath, cwdpath, d.db, GTAGS_READ, 0);
+		for (gtp = gtags_first(gtop, NULL, flags); gtp; gtp = gtags_next(gtop)) {
 			char fid[MAXFIDLEN];
 
-			ctags_x = parse_xid(ctags_xid, fid, NULL);
-			/* tag name */
-			(void)strcpy_withterm(tag, ctags_x, sizeof(tag), ' ');
-			if (strcmp(prev, tag)) {
-				count++;
-				if (vflag)
-					fprintf(stderr, " [%d] adding %s %s\n", count, kind, tag);
-				if (writing) {
-					if (!dynamic) {
-						fputs_nl(gen_list_end(), op);
-						fputs_nl(body_end, op);
-						fputs_nl(gen_page_end(), op);
-						close_file(fileop);
-						html_count++;
-					}
-					writing = 0;
-					/*
-					 * cache record: " <fid>\0<entry number>\0"
-					 */
-					strbuf_reset(tmp);
-					strbuf_putc(tmp, ' ');
-					strbuf_putn(tmp, count - 1);
-					strbuf_putc(tmp, '\0');
-					strbuf_putn(tmp, entry_count);
-					cache_put(db, prev, strbuf_value(tmp), strbuf_getlen(tmp) + 1);
-				}				
-				/* single entry */
-				if (first_line[0]) {
-					char fid[MAXFIDLEN];
-					const char *ctags_x = parse_xid(first_line, fid, NULL);
-					const char *lno = nextelement(ctags_x);
+			/*
+			 * tagline = <file id> <tag name> <line no>...
+			 */
+			(void)strcpy_withterm(fid, gtp->tagline, sizeof(fid), ' ');
+			if (gtop->format & GTAGS_COMPACT) {
+				LNOLIST l;
+				const char *p = gtp->tagline;
+				int n;
 
-					strbuf_reset(tmp);
-					strbuf_puts_withterm(tmp, lno, ' ');
-					strbuf_putc(tmp, '\0');
-					strbuf_puts(tmp, fid);
-					cache_put(db, prev, strbuf_value(tmp), strbuf_getlen(tmp) + 1);
-				}
-				/*
-				 * Chop the tail of the line. It is not important.
-				 * strlimcpy(first_line, ctags_x, sizeof(first_line));
-				 */
-				strncpy(first_line, ctags_xid, sizeof(first_line));
-				first_line[sizeof(first_line) - 1] = '\0';
-				strlimcpy(prev, tag, sizeof(prev));
-				entry_count = 0;
+				p = locatestring(p, " ", MATCH_FIRST);
+				p = locatestring(p + 1, " ", MATCH_FIRST);
+				lnolist_open(&l, p + 1, gtop->format & GTAGS_COMPLINE);
+				while ((n = lnolist_next(&l)) > 0)
+					put_entry(&d, gtp->tag, fid, gtp->path, n,
+						dynamic ? NULL : srcline_get(srcline, gtp->path, n));
 			} else {
-				/* duplicate entry */
-				if (first_line[0]) {
-					char fid[MAXFIDLEN];
-					const char *ctags_x = parse_xid(first_line, fid, NULL);
+				const char *image = NULL;
 
-					if (!dynamic) {
-						char path[MAXPATHLEN];
-
-						snprintf(path, sizeof(path), "%s/%s/%d.%s", distpath, dirs[db], count, HTML);
-						fileop = open_output_file(path, 0);
-						op = get_descripter(fileop);
-						fputs_nl(gen_page_begin(tag, SUBDIR), op);
-						fputs_nl(body_begin, op);
-						fputs_nl(gen_list_begin(), op);
-						fputs_nl(gen_list_body(srcdir, ctags_x, fid), op);
-					}
-					writing = 1;
-					entry_count++;
-					first_line[0] = 0;
-				}
 				if (!dynamic) {
-					fputs_nl(gen_list_body(srcdir, ctags_x, fid), op);
+					/*
+					 * tagline = <file id> <tag name> <line no> <line image>
+					 */
+					image = locatestring(gtp->tagline, " ", MATCH_FIRST);
+					image = locatestring(image + 1, " ", MATCH_FIRST);
+					image = locatestring(image + 1, " ", MATCH_FIRST) + 1;
+					if (gtop->format & GTAGS_COMPRESS)
+						image = uncompress(image, gtp->tag);
 				}
-				entry_count++;
+				put_entry(&d, gtp->tag, fid, gtp->path, gtp->lineno, image);
 			}
 		}
-		if (db == GTAGS)
-			definition_count = count;
-		if (pclose(ip) != 0)
-			die("terminated abnormally '%s' (errno = %d).", strbuf_value(command), errno);
-		if (writing) {
-			if (!dynamic) {
-				fputs_nl(gen_list_end(), op);
-				fputs_nl(body_end, op);
-				fputs_nl(gen_page_end(), op);
-				close_file(fileop);
-				html_count++;
-			}
-			/*
-			 * cache record: " <fid>\0<entry number>\0"
-			 */
-			strbuf_reset(tmp);
-			strbuf_putc(tmp, ' ');
-			strbuf_putn(tmp, count);
-			strbuf_putc(tmp, '\0');
-			strbuf_putn(tmp, entry_count);
-			cache_put(db, prev, strbuf_value(tmp), strbuf_getlen(tmp) + 1);
-		}
-		if (first_line[0]) {
-			char fid[MAXFIDLEN];
-			const char *ctags_x = parse_xid(first_line, fid, NULL);
-			const char *lno = nextelement(ctags_x);
-
-			strbuf_reset(tmp);
-			strbuf_puts_withterm(tmp, lno, ' ');
-			strbuf_putc(tmp, '\0');
-			strbuf_puts(tmp, fid);
-			cache_put(db, prev, strbuf_value(tmp), strbuf_getlen(tmp) + 1);
-		}
+		if (d.count > 0)
+			flush_tag(&d);
+		gtags_close(gtop);
+		if (d.db == GTAGS)
+			definition_count = d.count;
 	}
-	strbuf_close(sb);
-	strbuf_close(tmp);
-	strbuf_close(command);
+	srcline_close(srcline);
+	strbuf_close(d.tag);
+	strbuf_close(d.first_fid);
+	strbuf_close(d.first_line);
+	strbuf_close(d.line);
 	return definition_count;
 }
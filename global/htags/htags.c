@@ -38,6 +38,9 @@
 #include <signal.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#if !defined(_WIN32) || defined(__CYGWIN__)
+#include <sys/wait.h>
+#endif
 #include <sys/param.h>
 #include <errno.h>
 
@@ -131,6 +134,8 @@ int fixed_guide;			/**< --fixed-guide		*/
 const char *tree_view_type;		/**< --type-view=[type]		*/
 char *auto_completion_limit = "0";	/**< --auto-completion=limit	*/
 int statistics = STATISTICS_STYLE_NONE;	/**< --statistics option		*/
+int jobs = 1;				/**< --jobs option		*/
+int incremental;			/**< --incremental option	*/
 
 int no_order_list;			/**< 1: doesn't use order list	*/
 int other_files;			/**< 1: list other files		*/
@@ -286,6 +291,7 @@ static struct option const long_options[] = {
         {"disable-idutils", no_argument, &enable_idutils, 0},
         {"full-path", no_argument, &full_path, 1},
         {"fixed-guide",  no_argument, &fixed_guide, 1},
+        {"incremental", no_argument, &incremental, 1},
         {"map-file", no_argument, &map_file, 1},
         {"no-order-list", no_argument, &no_order_list, 1},
         {"show-position", no_argument, &show_position, 1},
@@ -312,6 +318,7 @@ static struct option const long_options[] = {
 #define OPT_HTML_HEADER		140
 #define OPT_CALL_TREE		141
 #define OPT_CALLEE_TREE		142
+#define OPT_JOBS		143
         {"auto-completion", optional_argument, NULL, OPT_AUTO_COMPLETION},
         {"call-tree", required_argument, NULL, OPT_CALL_TREE},
         {"callee-tree", required_argument, NULL, OPT_CALLEE_TREE},
@@ -325,6 +332,7 @@ static struct option const long_options[] = {
         {"insert-footer", required_argument, NULL, OPT_INSERT_FOOTER},
         {"insert-header", required_argument, NULL, OPT_INSERT_HEADER},
         {"item-order", required_argument, NULL, OPT_ITEM_ORDER},
+        {"jobs", required_argument, NULL, OPT_JOBS},
 	{"tabs", required_argument, NULL, OPT_TABS},
         {"tree-view",  optional_argument, NULL, OPT_TREE_VIEW},
         { 0 }
@@ -727,22 +735,291 @@ makehtaccess(const char *cgidir, const char *file, int perm)
 	if (chmod(dst, perm) < 0)
 		die("cannot chmod .htaccess skeleton.");
 }
+/*
+ * Incremental conversion.
+ *
+ * If the --incremental option is specified, htags records the stamp
+ * of each source page in file STAMPS of the dist directory, and
+ * converts only files whose stamp has changed since the last run.
+ * The stamp consists of the modification time and the size of the
+ * source file and a hash value of the other inputs of the page: the
+ * anchors in it with their entries in the tag cache, the files which
+ * include it, and the include files which it refers to. The names of
+ * the latter are kept in the stamp, because they are known only after
+ * the page is made; they don't change unless the source file changes.
+ *
+ * STAMPS
+ *	+-----------------------------------------------+
+ *	|<signature>                                    |
+ *	|<fid> <mtime> <size> <hash>[ <name>/<name>/...]|
+ *	|...                                            |
+ *	+-----------------------------------------------+
+ *
+ * If the signature of the version, the configuration and the options
+ * doesn't match, all files are converted. The options which don't
+ * change the pages (--jobs, --incremental, -q, -v and --statistics)
+ * are not included in the signature.
+ * The pages of the files which were recorded in the last run but are
+ * no longer in GPATH are removed.
+ */
+#define STAMPS		"STAMPS"
+static STRHASH *stamps;			/**< fid -> stamp of the last run */
+static unsigned long option_hash;	/**< hash value of the options */
+
 /**
- * makehtml: make html files
+ * hash_bytes: FNV-1a hash function.
  *
- *	@param[in]	total	number of files.
+ *	@param[in]	h	hash value so far
+ *	@param[in]	s	data
+ *	@param[in]	len	length of data
+ *	@return		hash value
+ */
+static unsigned long
+hash_bytes(unsigned long h, const char *s, int len)
+{
+	while (len-- > 0)
+		h = ((h ^ (unsigned char)*s++) * 16777619UL) & 0xffffffffUL;
+	return h;
+}
+#define HASH_INIT		2166136261UL
+#define hash_string(h, s)	hash_bytes(h, s, strlen(s) + 1)
+
+static unsigned long
+hash_number(unsigned long h, int n)
+{
+	char buf[32];
+
+	snprintf(buf, sizeof(buf), "%d", n);
+	return hash_string(h, buf);
+}
+/**
+ * load_stamps: load the stamps of the last run.
+ *
+ * This must be called after the include file index is made.
  */
 static void
-makehtml(int total)
+load_stamps(void)
+{
+	STRBUF *sb = strbuf_open(0);
+	char signature[32];
+	const char *line;
+	FILE *ip;
+
+	snprintf(signature, sizeof(signature), "%lu",
+		hash_string(hash_string(option_hash, VERSION), save_config));
+	stamps = strhash_open(1024);
+	ip = fopen(makepath(distpath, STAMPS, NULL), "r");
+	if (ip != NULL) {
+		line = strbuf_fgets(sb, ip, STRBUF_NOCRLF);
+		if (line != NULL && !strcmp(line, signature)) {
+			while ((line = strbuf_fgets(sb, ip, STRBUF_NOCRLF)) != NULL) {
+				const char *p = locatestring(line, " ", MATCH_FIRST);
+				struct sh_entry *entry;
+
+				if (p == NULL)
+					die("invalid stamp file. '%s'", line);
+				entry = strhash_assign(stamps, strmake(line, " "), 1);
+				entry->value = strhash_strdup(stamps, p + 1, 0);
+			}
+		}
+		fclose(ip);
+	}
+	/*
+	 * The first line of the new stamp file.
+	 */
+	ip = fopen(makepath(distpath, STAMPS ".0", NULL), "w");
+	if (ip == NULL)
+		die("cannot create file '%s'.", STAMPS ".0");
+	fputs_nl(signature, ip);
+	fclose(ip);
+	strbuf_close(sb);
+}
+/**
+ * save_stamps: save the stamps made by makehtml_part().
+ *
+ *	@param[in]	parts	number of parts
+ */
+static void
+save_stamps(int parts)
+{
+	STRBUF *sb = strbuf_open(0);
+	struct sh_entry *entry;
+	char path[MAXPATHLEN];
+	FILE *ip, *op;
+	int part;
+
+	strlimcpy(path, makepath(distpath, STAMPS ".0", NULL), sizeof(path));
+	op = fopen(path, "a");
+	if (op == NULL)
+		die("cannot open file '%s'.", path);
+	for (part = 1; part < parts; part++) {
+		char name[32];
+		const char *line;
+
+		snprintf(name, sizeof(name), "%s.%d", STAMPS, part);
+		if ((ip = fopen(makepath(distpath, name, NULL), "r")) == NULL)
+			continue;
+		while ((line = strbuf_fgets(sb, ip, STRBUF_NOCRLF)) != NULL)
+			fputs_nl(line, op);
+		fclose(ip);
+		(void)unlink(makepath(distpath, name, NULL));
+	}
+	fclose(op);
+	if (rename(path, makepath(distpath, STAMPS, NULL)) < 0)
+		die("cannot rename file '%s'.", path);
+	/*
+	 * Remove the pages of the files which were removed from GPATH.
+	 */
+	for (entry = strhash_first(stamps); entry; entry = strhash_next(stamps)) {
+		if (gpath_fid2path(entry->name, NULL) == NULL) {
+			snprintf(path, sizeof(path), "%s/%s/%s.%s", distpath, SRCS, entry->name, HTML);
+			(void)unlink(path);
+		}
+	}
+	strhash_close(stamps);
+	strbuf_close(sb);
+}
+/**
+ * page_hash: hash value of the anchors, the directories and the including
+ * files of a page.
+ *
+ *	@param[in]	path	path name
+ *	@param[in]	notsource 1: not source file
+ *	@return		hash value
+ *
+ * The anchors of the file must have been loaded by anchor_load().
+ */
+static unsigned long
+page_hash(const char *path, int notsource)
+{
+	STATIC_STRBUF(sb);
+	unsigned long h = hash_number(HASH_INIT, notsource);
+	const char *basename, *p, *fid;
+	struct anchor *a;
+	struct data *incref;
+
+	/*
+	 * The header links to the index pages of the directories.
+	 */
+	for (p = path; (p = locatestring(p, "/", MATCH_FIRST)) != NULL; p++) {
+		strbuf_clear(sb);
+		strbuf_nputs(sb, path, p - path);
+		fid = path2fid_readonly(strbuf_value(sb));
+		h = hash_string(h, fid ? fid : "");
+	}
+	for (a = anchor_first(); a; a = anchor_next()) {
+		const char *line;
+		int db;
+
+		if (a->type == 'R')
+			db = GTAGS;
+		else if (a->type == 'Y')
+			db = GSYMS;
+		else
+			db = GRTAGS;
+		h = hash_number(h, a->lineno);
+		h = hash_bytes(h, &a->type, 1);
+		h = hash_string(h, gettag(a));
+		if ((line = cache_get(db, gettag(a))) != NULL) {
+			h = hash_string(h, line);
+			h = hash_string(h, nextstring(line));
+		}
+	}
+	basename = locatestring(path, "/", MATCH_LAST);
+	incref = get_included(basename ? basename + 1 : path);
+	if (incref) {
+		h = hash_number(h, incref->ref_count);
+		if (incref->ref_count > 1)
+			h = hash_number(h, incref->id);
+		if (incref->ref_contents)
+			h = hash_bytes(h, strbuf_value(incref->ref_contents), strbuf_getlen(incref->ref_contents));
+	}
+	return h;
+}
+/**
+ * make_stamp: make the stamp of the current file.
+ *
+ *	@param[in]	path	path name
+ *	@param[in]	h	hash value made by page_hash()
+ *	@param[in]	includes	include files referred to by the page
+ *				(names separated by '/')
+ *	@return		stamp, NULL: cannot be decided
+ */
+static const char *
+make_stamp(const char *path, unsigned long h, const char *includes)
+{
+	STATIC_STRBUF(sb);
+	char buf[128];
+	const char *p, *q;
+	struct data *inc;
+	struct stat st;
+
+	/*
+	 * Every symbol may be a link when GRTAGS is empty.
+	 */
+	if (grtags_is_empty || stat(path, &st) < 0)
+		return NULL;
+	/*
+	 * An include file is linked to its only file or to its index page.
+	 */
+	for (p = includes; *p; p = *q ? q + 1 : q) {
+		for (q = p; *q && *q != '/'; q++)
+			;
+		strbuf_clear(sb);
+		strbuf_nputs(sb, p, q - p);
+		h = hash_string(h, strbuf_value(sb));
+		if ((inc = get_inc(strbuf_value(sb))) == NULL)
+			continue;
+		h = hash_number(h, inc->count);
+		if (inc->count > 1)
+			h = hash_number(h, inc->id);
+		else
+			h = hash_string(h, path2fid(strbuf_value(inc->contents)));
+	}
+	snprintf(buf, sizeof(buf), "%ld %ld %lu", (long)st.st_mtime, (long)st.st_size, h);
+	strbuf_clear(sb);
+	strbuf_puts(sb, buf);
+	if (*includes) {
+		strbuf_putc(sb, ' ');
+		strbuf_puts(sb, includes);
+	}
+	return strbuf_value(sb);
+}
+/**
+ * stamp_includes: include files recorded in a stamp.
+ *
+ *	@param[in]	stamp	stamp made by make_stamp()
+ *	@return		names separated by '/'
+ */
+static const char *
+stamp_includes(const char *stamp)
+{
+	int n;
+
+	for (n = 0; n < 3; n++) {
+		if ((stamp = locatestring(stamp, " ", MATCH_FIRST)) == NULL)
+			return "";
+		stamp++;
+	}
+	return stamp;
+}
+/**
+ * open_anchor_stream: make the path list of a part for anchor_prepare().
+ *
+ *	@param[in]	part	part number (0 .. parts - 1)
+ *	@param[in]	parts	number of parts
+ *	@return		file pointer of path list
+ *
+ * The n-th file in GPATH belongs to the part (n % parts).
+ */
+static FILE *
+open_anchor_stream(int part, int parts)
 {
 	GFIND *gp;
 	FILE *anchor_stream;
 	const char *path;
 	int count = 0;
 
-	/*
-	 * Create anchor stream for anchor_load().
-	 */
 	anchor_stream = tmpfile();
 #if defined(_WIN32) && !defined(__CYGWIN__)
 	/*
@@ -757,23 +1034,53 @@ makehtml(int total)
 #endif
 	gp = gfind_open(dbpath, NULL, other_files ? GPATH_BOTH : GPATH_SOURCE, 0);
 	while ((path = gfind_read(gp)) != NULL) {
+		if (count++ % parts != part)
+			continue;
 		if (gp->type == GPATH_OTHER)
 			fputc(' ', anchor_stream);
 		fputs(path, anchor_stream);
 		fputc('\n', anchor_stream);
 	}
 	gfind_close(gp);
-	/*
-	 * Prepare anchor stream for anchor_load().
-	 */
-	anchor_prepare(anchor_stream);
+	return anchor_stream;
+}
+/**
+ * makehtml_part: make html files of a part of the project
+ *
+ *	@param[in]	total	number of files.
+ *	@param[in]	part	part number (0 .. parts - 1)
+ *	@param[in]	parts	number of parts
+ *
+ * The n-th file in GPATH belongs to the part (n % parts).
+ * The anchors must be prepared by anchor_prepare().
+ */
+static void
+makehtml_part(int total, int part, int parts)
+{
+	GFIND *gp;
+	FILE *stamp_stream = NULL;
+	const char *path;
+	unsigned long h = 0;
+	int count = 0;
+
+	if (incremental) {
+		char name[32];
+
+		snprintf(name, sizeof(name), "%s.%d", STAMPS, part);
+		stamp_stream = fopen(makepath(distpath, name, NULL), part == 0 ? "a" : "w");
+		if (stamp_stream == NULL)
+			die("cannot create file '%s'.", name);
+	}
 	/*
 	 * For each path in GPATH, convert the path into HTML file.
 	 */
+	count = 0;
 	gp = gfind_open(dbpath, NULL, other_files ? GPATH_BOTH : GPATH_SOURCE, 0);
 	while ((path = gfind_read(gp)) != NULL) {
 		char html[MAXPATHLEN];
 
+		if (count++ % parts != part)
+			continue;
 		if (gp->type == GPATH_OTHER && !other_files)
 			continue;
 		/*
@@ -785,13 +1092,120 @@ makehtml(int total)
 		 * inform the current path name to lex() function.
 		 */
 		save_current_path(path);
-		count++;
 		path += 2;		/* remove './' at the head */
-		message(" [%d/%d] converting %s", count, total, path);
 		snprintf(html, sizeof(html), "%s/%s/%s.%s", distpath, SRCS, path2fid(path), HTML);
+		if (incremental) {
+			struct sh_entry *entry = strhash_assign(stamps, path2fid(path), 0);
+
+			/* the anchors are unloaded by src2html() */
+			h = page_hash(path, gp->type == GPATH_OTHER);
+			if (entry && test("f", html)) {
+				const char *stamp = make_stamp(path, h, stamp_includes(entry->value));
+
+				if (stamp && !strcmp(entry->value, stamp)) {
+					fprintf(stamp_stream, "%s %s\n", path2fid(path), stamp);
+					message(" [%d/%d] skipping %s", count, total, path);
+					anchor_unload();
+					continue;
+				}
+			}
+			reset_referred();
+		}
+		message(" [%d/%d] converting %s", count, total, path);
 		src2html(path, html, gp->type == GPATH_OTHER);
+		if (incremental) {
+			const char *stamp = make_stamp(path, h, get_referred());
+
+			if (stamp)
+				fprintf(stamp_stream, "%s %s\n", path2fid(path), stamp);
+		}
 	}
 	gfind_close(gp);
+	if (stamp_stream)
+		fclose(stamp_stream);
+}
+/**
+ * makehtml: make html files
+ *
+ *	@param[in]	total	number of files.
+ *
+ * If the --jobs option is specified, the files are divided among
+ * child processes. Since each file is converted independently,
+ * the result is the same as that of a serial run.
+ * The anchors of all files are read from the tag files only once,
+ * before the files are divided.
+ */
+static void
+makehtml(int total)
+{
+	FILE *anchor_stream;
+#if !defined(_WIN32) || defined(__CYGWIN__)
+	pid_t *pids;
+	int job, failed = 0;
+#endif
+
+	anchor_stream = open_anchor_stream(0, 1);
+	anchor_prepare(anchor_stream);
+	fclose(anchor_stream);
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	makehtml_part(total, 0, 1);
+	anchor_close();
+#else
+	if (jobs <= 1) {
+		makehtml_part(total, 0, 1);
+		anchor_close();
+		return;
+	}
+	pids = (pid_t *)check_calloc(sizeof(pid_t), jobs);
+	for (job = 0; job < jobs; job++) {
+		int fd[2];
+		char c;
+
+		if (pipe(fd) < 0)
+			die("cannot make pipe.");
+		fflush(NULL);
+		if ((pids[job] = fork()) < 0)
+			die("cannot fork.");
+		if (pids[job] == 0) {
+			/*
+			 * The tag cache, the GPATH table and the anchors are
+			 * stored in temporary files which were opened by the
+			 * parent. Each child copies them to its own files, so
+			 * that children do not share file offsets.
+			 */
+			close(fd[0]);
+			cache_dup();
+			dup_gpath();
+			anchor_stream = open_anchor_stream(job, jobs);
+			anchor_dup(anchor_stream);
+			fclose(anchor_stream);
+			close(fd[1]);
+			makehtml_part(total, job, jobs);
+			anchor_close();
+			clean();
+			exit(0);
+		}
+		/*
+		 * Wait until the child finishes copying.
+		 */
+		close(fd[1]);
+		while (read(fd[0], &c, 1) > 0)
+			;
+		close(fd[0]);
+	}
+	for (job = 0; job < jobs; job++) {
+		int status;
+
+		if (waitpid(pids[job], &status, 0) < 0)
+			die("waitpid failed.");
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			failed++;
+	}
+	free(pids);
+	anchor_close();
+	if (failed)
+		die("%d of %d jobs failed.", failed, jobs);
+#endif
 }
 /**
  * makecommonpart: make a common part for "mains.html" and "index.html"
@@ -1127,7 +1541,21 @@ main(int argc, char **argv)
 		if (env && *env)
 			argv = prepend_options(&argc, argv, env);
 	}
+	option_hash = HASH_INIT;
 	while ((optchar = getopt_long(argc, argv, "acd:DfFghIm:nNoqst:Tvwx", long_options, &option_index)) != EOF) {
+		/*
+		 * Options which may change the pages are recorded in the
+		 * signature of the stamp file. (See load_stamps())
+		 */
+		if (optchar == 0) {
+			if (long_options[option_index].flag != &incremental
+			    && long_options[option_index].flag != &statistics)
+				option_hash = hash_string(option_hash, long_options[option_index].name);
+		} else if (optchar != OPT_JOBS && optchar != 'q' && optchar != 'v') {
+			option_hash = hash_number(option_hash, optchar);
+			if (optarg)
+				option_hash = hash_string(option_hash, optarg);
+		}
 		switch (optchar) {
 		case 0:
 			/* already flags set */
@@ -1185,6 +1613,12 @@ main(int argc, char **argv)
 			else
 				die("--tabs option requires numeric value.");
                         break;
+		case OPT_JOBS:
+			if (atoi(optarg) > 0)
+				jobs = atoi(optarg);
+			else
+				die("--jobs option requires numeric value.");
+			break;
 		case OPT_NCOL:
 			if (atoi(optarg) > 0)
 				ncol = atoi(optarg);
@@ -1642,7 +2076,13 @@ main(int argc, char **argv)
 	 */
 	message("[%s] (9) making hypertext from source code ...", now());
 	tim = statistics_time_start("Time of making hypertext");
+	if (incremental)
+		load_stamps();
+	else
+		(void)unlink(makepath(distpath, STAMPS, NULL));
 	makehtml(file_total);
+	if (incremental)
+		save_stamps(jobs);
 	statistics_time_end(tim);
 	/*
 	 * (10) rebuild script. (rebuild.sh)
@@ -23,6 +23,11 @@
 #ifdef STDC_HEADERS
 #include <stdlib.h>
 #endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#else
+#include <strings.h>
+#endif
 #include "global.h"
 #include "incop.h"
 
@@ -161,6 +166,57 @@ get_included(const char *name)
 
 	return (data && data->ref_count) ? data : NULL;
 }
+/*----------------------------------------------------------------------*/
+/* Include files referred to by a page					*/
+/*----------------------------------------------------------------------*/
+static STRBUF *referred;
+
+/**
+ * reset_referred: start recording the include files referred to by a page.
+ */
+void
+reset_referred(void)
+{
+	if (referred == NULL)
+		referred = strbuf_open(0);
+	strbuf_reset(referred);
+}
+/**
+ * put_referred: record an include file referred to by the page.
+ *
+ *	@param[in]	data	inc structure
+ *
+ * The names are separated by '/', which cannot appear in them.
+ * Nothing is recorded unless reset_referred() has been called.
+ */
+void
+put_referred(struct data *data)
+{
+	const char *p, *q;
+	int len = strlen(data->name);
+
+	if (referred == NULL)
+		return;
+	for (p = strbuf_value(referred); *p; p = *q ? q + 1 : q) {
+		for (q = p; *q && *q != '/'; q++)
+			;
+		if (q - p == len && !strncmp(p, data->name, len))
+			return;
+	}
+	if (strbuf_getlen(referred) > 0)
+		strbuf_putc(referred, '/');
+	strbuf_puts(referred, data->name);
+}
+/**
+ * get_referred: get the include files referred to by the page.
+ *
+ *	@return		names separated by '/'
+ */
+const char *
+get_referred(void)
+{
+	return referred ? strbuf_value(referred) : "";
+}
 /*
  * Terminate function is not needed.
  */
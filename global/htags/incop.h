@@ -41,5 +41,8 @@ struct data *first_inc(void);
 struct data *next_inc(void);
 void put_included(struct data *, const char *);
 struct data *get_included(const char *);
+void reset_referred(void);
+void put_referred(struct data *);
+const char *get_referred(void);
 
 #endif /* ! _INCOP_H */
@@ -74,6 +74,20 @@ unload_gpath(void)
 {
 	assoc_close(assoc);
 }
+/**
+ * dup_gpath: replace the loaded GPATH with a private copy.
+ *
+ * A child process calls this so that it does not share the file offset
+ * of the temporary file with other processes.
+ */
+void
+dup_gpath(void)
+{
+	ASSOC *new = assoc_dup(assoc);
+
+	assoc_close(assoc);
+	assoc = new;
+}
 /**
  * path2fid: convert the path name into the file id.
  *
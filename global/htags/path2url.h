@@ -23,5 +23,6 @@ void load_gpath(const char *);
 const char *path2fid(const char *);
 const char *path2fid_readonly(const char *);
 void unload_gpath(void);
+void dup_gpath(void);
 
 #endif /* ! _GPATH_H_ */
@@ -529,6 +529,7 @@ put_anchor_force(char *name, int length, int lineno)
 void
 put_include_anchor(struct data *inc, const char *path)
 {
+	put_referred(inc);
 	if (inc->count == 1)
 		strbuf_puts(outbuf, gen_href_begin(NULL, path2fid(strbuf_value(inc->contents)), HTML, NULL));
 	else {
@@ -397,6 +397,18 @@ getconf(const char *name)
 	return check_strdup(strbuf_value(sb));
 }
 
+/*
+ * Default batch callback: pass each tag to the put callback.
+ */
+static PARSER_CALLBACK put_each;
+static void
+put_batch_default(const struct parser_tag *tags, int count, const char *file, void *arg)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		put_each(tags[i].type, tags[i].tag, tags[i].lineno, file, tags[i].image, arg);
+}
 /**
  * parse_file: select and execute a parser.
  *
@@ -408,6 +420,23 @@ getconf(const char *name)
  */
 void
 parse_file(const char *path, int flags, PARSER_CALLBACK put, void *arg)
+{
+	parse_file_batch(path, flags, put, NULL, arg);
+}
+/**
+ * parse_file_batch: select and execute a parser.
+ *
+ *	@param[in]	path	path name
+ *	@param[in]	flags	PARSER_WARNING: print warning messages
+ *	@param[in]	put	callback routine,
+ *			each parser use this routine for output
+ *	@param[in]	put_batch	callback routine for an array of tags,
+ *			plug-in parsers may use this instead of put.
+ *			If NULL, put is called for each tag.
+ *	@param[in]	arg	argument for callback routine
+ */
+void
+parse_file_batch(const char *path, int flags, PARSER_CALLBACK put, PARSER_BATCH_CALLBACK put_batch, void *arg)
 {
 	const char *lang, *suffix;
 	const struct lang_entry *ent;
@@ -446,6 +475,8 @@ parse_file(const char *path, int flags, PARSER_CALLBACK put, void *arg)
 	param.die = die;
 	param.warning = warning;
 	param.message = message;
+	put_each = put;
+	param.put_batch = put_batch ? put_batch : put_batch_default;
 	ent->parser(&param);
 }
 
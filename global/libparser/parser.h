@@ -21,6 +21,8 @@
 #ifndef _PARSER_H_
 #define _PARSER_H_
 
+#include <stddef.h>
+
 /*
  * Built-in parser base on gctags
  */
@@ -50,7 +52,17 @@ void parser_exit(void);
 
 typedef void (*PARSER_CALLBACK)(int, const char *, int, const char *, const char *, void *);
 
+/** tag record for the batch callback */
+struct parser_tag {
+	int type;		/**< PARSER_DEF or PARSER_REF_SYM */
+	const char *tag;	/**< tag name */
+	int lineno;		/**< line number */
+	const char *image;	/**< line image */
+};
+typedef void (*PARSER_BATCH_CALLBACK)(const struct parser_tag *, int, const char *, void *);
+
 void parse_file(const char *, int, PARSER_CALLBACK, void *);
+void parse_file_batch(const char *, int, PARSER_CALLBACK, PARSER_BATCH_CALLBACK, void *);
 
 struct parser_param {
 	int size;		/**< size of this structure */
@@ -64,6 +76,11 @@ struct parser_param {
 	void (*die)(const char *, ...);
 	void (*warning)(const char *, ...);
 	void (*message)(const char *, ...);
+	/* The following members are available if PARSER_PARAM_HAS() says so. */
+	PARSER_BATCH_CALLBACK put_batch;
 };
+/** whether the param includes the member (for plug-in parsers) */
+#define PARSER_PARAM_HAS(param, member)	\
+	((param)->size >= (int)(offsetof(struct parser_param, member) + sizeof((param)->member)))
 
 #endif
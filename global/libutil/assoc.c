@@ -73,6 +73,92 @@ assoc_close(ASSOC *assoc)
 #endif
 	free(assoc);
 }
+/**
+ * assoc_seq: sequential read of associate array.
+ *
+ *	@param[in]	assoc	descriptor
+ *	@param[out]	value	value of the entry
+ *	@param[in]	flag	R_FIRST or R_NEXT
+ *	@return		name of the entry, NULL: end of array
+ */
+static const char *
+assoc_seq(ASSOC *assoc, const char **value, int flag)
+{
+	DB *db = assoc->db;
+	DBT key, dat;
+	int status;
+
+	if (db == NULL)
+		die("associate array is not prepared.");
+	status = (*db->seq)(db, &key, &dat, flag);
+	switch (status) {
+	case RET_SUCCESS:
+		break;
+	case RET_ERROR:
+		die("cannot read from the associate array. (assoc_seq)");
+	case RET_SPECIAL:
+		return (NULL);
+	}
+	if (value)
+		*value = (const char *)dat.data;
+	return (const char *)key.data;
+}
+/**
+ * assoc_dup: duplicate associate array.
+ *
+ *	@param[in]	assoc	descriptor
+ *	@return		new descriptor
+ *
+ * The new array has its own temporary file. A child process can use it
+ * without sharing the file offset with other processes.
+ */
+ASSOC *
+assoc_dup(ASSOC *assoc)
+{
+	ASSOC *new = assoc_open();
+	DB *db = assoc->db;
+	DBT key, dat;
+	int status;
+
+	if (db == NULL)
+		die("associate array is not prepared.");
+	for (status = (*db->seq)(db, &key, &dat, R_FIRST);
+	     status == RET_SUCCESS;
+	     status = (*db->seq)(db, &key, &dat, R_NEXT))
+	{
+		if ((*new->db->put)(new->db, &key, &dat, 0) != RET_SUCCESS)
+			die("cannot write to the associate array. (assoc_dup)");
+	}
+	if (status == RET_ERROR)
+		die("cannot read the associate array. (assoc_dup)");
+	return new;
+}
+/**
+ * assoc_first: get the first entry of associate array.
+ *
+ *	@param[in]	assoc	descriptor
+ *	@param[out]	value	value of the entry
+ *	@return		name of the entry, NULL: end of array
+ *
+ * Entries are returned in the order of the names.
+ */
+const char *
+assoc_first(ASSOC *assoc, const char **value)
+{
+	return assoc_seq(assoc, value, R_FIRST);
+}
+/**
+ * assoc_next: get the next entry of associate array.
+ *
+ *	@param[in]	assoc	descriptor
+ *	@param[out]	value	value of the entry
+ *	@return		name of the entry, NULL: end of array
+ */
+const char *
+assoc_next(ASSOC *assoc, const char **value)
+{
+	return assoc_seq(assoc, value, R_NEXT);
+}
 /**
  * assoc_put: put data into associate array.
  *
@@ -27,6 +27,9 @@ typedef struct {
 
 ASSOC *assoc_open(void);
 void assoc_close(ASSOC *);
+ASSOC *assoc_dup(ASSOC *);
+const char *assoc_first(ASSOC *, const char **);
+const char *assoc_next(ASSOC *, const char **);
 void assoc_put(ASSOC *, const char *, const char *);
 void assoc_put_withlen(ASSOC *, const char *, const char *, int);
 const char *assoc_get(ASSOC *, const char *);
@@ -21,6 +21,11 @@
 #include <config.h>
 #endif
 #include <ctype.h>
+#ifdef HAVE_STRING_H
+#include <string.h>
+#else
+#include <strings.h>
+#endif
 
 #include "char.h"
 #include "strbuf.h"
@@ -61,6 +66,30 @@ isregex(const char *s)
 			return 1;
 	return 0;
 }
+/**
+ * trim_pattern: trim pattern (^<no regex>$ => <no regex>)
+ *
+ *	@param[in]	pattern	search pattern
+ *	@return		trimmed pattern or pattern itself
+ *
+ *	Examples:
+ *	'^main$' => 'main'
+ *	'^ma.n$' => '^ma.n$'
+ */
+const char *
+trim_pattern(const char *pattern)
+{
+	STATIC_STRBUF(sb);
+	int len = strlen(pattern);
+
+	if (len >= 2 && pattern[0] == '^' && pattern[len - 1] == '$') {
+		strbuf_clear(sb);
+		strbuf_nputs(sb, pattern + 1, len - 2);
+		if (strbuf_getlen(sb) == 0 || !isregex(strbuf_value(sb)))
+			return strbuf_value(sb);
+	}
+	return pattern;
+}
 /**
  * quote string.
  *
@@ -37,6 +37,7 @@ extern const unsigned char chartype[256];
 #define isbinarychar(c)		test_chartype(c, BINARYCHAR)
 
 int isregex(const char *);
+const char *trim_pattern(const char *);
 const char *quote_string(const char *);
 const char *quote_chars(const char *, unsigned int);
 const char *quote_shell(const char *);
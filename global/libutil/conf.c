@@ -48,6 +48,7 @@
 #include "makepath.h"
 #include "path.h"
 #include "strbuf.h"
+#include "strhash.h"
 #include "strlimcpy.h"
 #include "strmake.h"
 #include "test.h"
@@ -63,8 +64,19 @@ static char *config_label;
  */
 static int allowed_nest_level = 32;
 static int opened;
+/**
+ * Compiled form of confline.
+ *
+ * table:	raw values indexed by "<name>=", "<name>#" or "<name>:"
+ * resolved:	values returned by getconfs() indexed by name
+ */
+static STRHASH *table;
+static STRHASH *resolved;
+static char notfound[] = "";
 
 static void trim(char *);
+static void compileconf(void);
+static void discardconf(void);
 static const char *readrecord(FILE *, const char *);
 static void includelabel(FILE *, STRBUF *, const char *, int);
 
@@ -325,11 +337,102 @@ openconf(const char *rootdir)
 	}
 	strbuf_unputc(sb, ':');
 	strbuf_putc(sb, ':');
+	free(confline);
 	confline = check_strdup(strbuf_value(sb));
+	discardconf();
 	strbuf_close(sb);
 	trim(confline);
 	return;
 }
+/**
+ * isall: whether the values of the property are concatenated.
+ *
+ *	@param[in]	name	property name
+ *	@return		1: all values, 0: the first value only
+ */
+static int
+isall(const char *name)
+{
+	return (!strcmp(name, "skip") || !strcmp(name, "gtags_parser") || !strcmp(name, "langmap"));
+}
+/**
+ * compileconf: compile confline into the lookup table.
+ *
+ * Each field of confline is registered once, so that getconf[nsb]()
+ * need not scan confline for every call.
+ *	:name=value:	"name=" -> value (concatenated with ',' for isall())
+ *	:name#number:	"name#" -> number
+ *	:name:		"name:"
+ */
+static void
+compileconf(void)
+{
+	STRBUF *key = strbuf_open(0);
+	STRBUF *value = strbuf_open(0);
+	struct sh_entry *entry;
+	const char *p = confline;
+
+	table = strhash_open(64);
+	resolved = strhash_open(64);
+	while (*p) {
+		const char *name;
+		int type = ':';
+		int all;
+
+		if (*p++ != ':')
+			continue;
+		if (*p == '\0')
+			break;
+		strbuf_reset(key);
+		strbuf_reset(value);
+		for (name = p; *p && *p != ':' && *p != '=' && *p != '#'; p++)
+			;
+		strbuf_nputs(key, name, p - name);
+		if (*p == '=' || *p == '#') {
+			type = *p++;
+			for (; *p; p++) {
+				if (*p == ':')
+					break;
+				if (*p == '\\' && *(p + 1) == ':')	/* quoted character */
+					p++;
+				strbuf_putc(value, *p);
+			}
+		}
+		if (strbuf_getlen(key) == 0)
+			continue;
+		all = (type == '=' && isall(strbuf_value(key)));
+		strbuf_putc(key, type);
+		entry = strhash_assign(table, strbuf_value(key), 1);
+		if (entry->value == NULL) {
+			entry->value = strhash_strdup(table, strbuf_value(value), 0);
+		} else if (all) {
+			STRBUF *sb = strbuf_open(0);
+
+			strbuf_puts(sb, (char *)entry->value);
+			strbuf_putc(sb, ',');
+			strbuf_puts(sb, strbuf_value(value));
+			entry->value = strhash_strdup(table, strbuf_value(sb), 0);
+			strbuf_close(sb);
+		}
+	}
+	strbuf_close(key);
+	strbuf_close(value);
+}
+/**
+ * discardconf: discard the compiled form of confline.
+ */
+static void
+discardconf(void)
+{
+	if (table) {
+		strhash_close(table);
+		table = NULL;
+	}
+	if (resolved) {
+		strhash_close(resolved);
+		resolved = NULL;
+	}
+}
 /**
  * getconfn: get property number
  *
@@ -340,16 +443,17 @@ openconf(const char *rootdir)
 int
 getconfn(const char *name, int *num)
 {
-	const char *p;
+	struct sh_entry *entry;
 	char buf[MAXPROPLEN];
 
 	if (!opened)
 		die("configuration file not opened.");
-	snprintf(buf, sizeof(buf), ":%s#", name);
-	if ((p = locatestring(confline, buf, MATCH_FIRST)) != NULL) {
-		p += strlen(buf);
+	if (table == NULL)
+		compileconf();
+	snprintf(buf, sizeof(buf), "%s#", name);
+	if ((entry = strhash_assign(table, buf, 0)) != NULL) {
 		if (num != NULL)
-			*num = atoi(p);
+			*num = atoi((char *)entry->value);
 		return 1;
 	}
 	return 0;
@@ -416,11 +520,9 @@ int
 getconfs(const char *name, STRBUF *result)
 {
 	STRBUF *sb = NULL;
-	const char *p;
+	struct sh_entry *entry;
 	char buf[MAXPROPLEN];
-	int all = 0;
 	int exist = 0;
-	int bufsize;
 
 	if (!opened)
 		die("configuration file not opened.");
@@ -430,26 +532,23 @@ getconfs(const char *name, STRBUF *result)
 			strbuf_puts(result, config_path);
 		return 1;
 	}
+	if (table == NULL)
+		compileconf();
+	/*
+	 * The value is resolved only once.
+	 */
+	if ((entry = strhash_assign(resolved, name, 0)) != NULL) {
+		if (entry->value == notfound)
+			return 0;
+		if (result)
+			strbuf_puts(result, (char *)entry->value);
+		return 1;
+	}
 	sb = strbuf_open(0);
-	if (!strcmp(name, "skip") || !strcmp(name, "gtags_parser") || !strcmp(name, "langmap"))
-		all = 1;
-	snprintf(buf, sizeof(buf), ":%s=", name);
-	bufsize = strlen(buf);
-	p = confline;
-	while ((p = locatestring(p, buf, MATCH_FIRST)) != NULL) {
-		if (exist && sb)
-			strbuf_putc(sb, ',');		
+	snprintf(buf, sizeof(buf), "%s=", name);
+	if ((entry = strhash_assign(table, buf, 0)) != NULL) {
+		strbuf_puts(sb, (char *)entry->value);
 		exist = 1;
-		for (p += bufsize; *p; p++) {
-			if (*p == ':')
-				break;
-			if (*p == '\\' && *(p + 1) == ':')	/* quoted character */
-				p++;
-			if (sb)
-				strbuf_putc(sb, *p);
-		}
-		if (!all)
-			break;
 	}
 	/*
 	 * If 'bindir' and 'datadir' are not defined then
@@ -502,10 +601,15 @@ getconfs(const char *name, STRBUF *result)
 		}
 	}
 	replace_variables(sb);
-	if (result)
-		strbuf_puts(result, !strcmp(name, "langmap") ? 
+	entry = strhash_assign(resolved, name, 1);
+	if (!exist)
+		entry->value = notfound;
+	else
+		entry->value = strhash_strdup(resolved, !strcmp(name, "langmap") ?
 			trim_langmap(strbuf_value(sb)) :
-			strbuf_value(sb));
+			strbuf_value(sb), 0);
+	if (result && exist)
+		strbuf_puts(result, (char *)entry->value);
 	strbuf_close(sb);
 	return exist;
 }
@@ -522,8 +626,10 @@ getconfb(const char *name)
 
 	if (!opened)
 		die("configuration file not opened.");
-	snprintf(buf, sizeof(buf), ":%s:", name);
-	if (locatestring(confline, buf, MATCH_FIRST) != NULL)
+	if (table == NULL)
+		compileconf();
+	snprintf(buf, sizeof(buf), "%s:", name);
+	if (strhash_assign(table, buf, 0) != NULL)
 		return 1;
 	return 0;
 }
@@ -558,6 +664,7 @@ closeconf(void)
 {
 	if (!opened)
 		return;
+	discardconf();
 	free(confline);
 	confline = NULL;
 	opened = 0;
@@ -610,7 +610,8 @@ dbop_next(DBOP *dbop)
 	DB *db = dbop->db;
 	int flags = dbop->ioflags;
 	DBT key, dat;
-	int status;
+	int status, op = R_NEXT;
+	char nextkey[MAXKEYLEN + 2];
 
 	if (dbop->unread) {
 		dbop->unread = 0;
@@ -620,9 +621,10 @@ dbop_next(DBOP *dbop)
 	if (dbop->openflags & DBOP_SQLITE3)
 		return dbop3_next(dbop);
 #endif
-	while ((status = (*db->seq)(db, &key, &dat, R_NEXT)) == RET_SUCCESS) {
+	while ((status = (*db->seq)(db, &key, &dat, op)) == RET_SUCCESS) {
 		dbop->readcount++;
 		assert(dat.data != NULL);
+		op = R_NEXT;
 		/* skip meta records */
 		if (!(dbop->openflags & DBOP_RAW)) {
 			if (flags & DBOP_KEY && ismeta(key.data))
@@ -631,8 +633,22 @@ dbop_next(DBOP *dbop)
 				continue;
 		}
 		if (flags & DBOP_KEY) {
-			if (!strcmp(dbop->prev, (char *)key.data))
+			if (!strcmp(dbop->prev, (char *)key.data)) {
+				/*
+				 * Skip the rest of the records of this key by one
+				 * search instead of reading them one by one.
+				 * "<key>\001" (without '\0') is the least string
+				 * which is greater than any record of the key.
+				 */
+				int len = strlen(dbop->prev);
+
+				memcpy(nextkey, dbop->prev, len);
+				nextkey[len] = '\001';
+				key.data = nextkey;
+				key.size = len + 1;
+				op = R_CURSOR;
 				continue;
+			}
 			if (strlen((char *)key.data) > MAXKEYLEN)
 				die("primary key too long.");
 			strlimcpy(dbop->prev, (char *)key.data, sizeof(dbop->prev));
@@ -40,6 +40,10 @@
 #else
 #include <sys/file.h>
 #endif
+#if defined(HAVE_LIBZ) && defined(HAVE_ZLIB_H)
+#include <zlib.h>
+#define USE_ZLIB
+#endif
 
 #include "checkalloc.h"
 #include "die.h"
@@ -112,10 +116,21 @@ open_output_file(const char *path, int compress)
 	char command[MAXFILLEN];
 
 	if (compress) {
+#ifdef USE_ZLIB
+		/*
+		 * The output is stored into a temporary file, and is
+		 * compressed into the path by close_file().
+		 */
+		command[0] = '\0';
+		fp = tmpfile();
+		if (fp == NULL)
+			die("cannot make temporary file for '%s'.", path);
+#else
 		snprintf(command, sizeof(command), "gzip -c >\"%s\"", path);
 		fp = popen(command, "w");
 		if (fp == NULL)
 			die("cannot execute '%s'.", command);
+#endif
 	} else {
 		fp = fopen(path, "w");
 		if (fp == NULL)
@@ -131,6 +146,32 @@ open_output_file(const char *path, int compress)
 	fileop->fp = fp;
 	return fileop;
 }
+#ifdef USE_ZLIB
+/**
+ * compress_file: compress the contents of a file in gzip format.
+ *
+ *	@param[in]	ip	input file
+ *	@param[in]	path	path name of the compressed file
+ */
+static void
+compress_file(FILE *ip, const char *path)
+{
+	char buf[8192];
+	gzFile gz;
+	size_t n;
+
+	if ((gz = gzopen(path, "wb")) == NULL)
+		die("cannot create file '%s'.", path);
+	rewind(ip);
+	while ((n = fread(buf, 1, sizeof(buf), ip)) > 0)
+		if (gzwrite(gz, buf, n) != (int)n)
+			die("cannot write to '%s'.", path);
+	if (ferror(ip))
+		die("cannot read temporary file for '%s'.", path);
+	if (gzclose(gz) != Z_OK)
+		die("cannot close '%s'.", path);
+}
+#endif
 /**
  * get UNIX file descripter
  *
@@ -150,8 +191,13 @@ void
 close_file(FILEOP *fileop)
 {
 	if (fileop->type & FILEOP_COMPRESS) {
+#ifdef USE_ZLIB
+		compress_file(fileop->fp, fileop->path);
+		fclose(fileop->fp);
+#else
 		if (pclose(fileop->fp) != 0)
 			die("terminated abnormally. '%s'", fileop->command);
+#endif
 	} else
 		fclose(fileop->fp);
 	free(fileop);
@@ -241,22 +287,3 @@ copydirectory(const char *srcdir, const char *distdir)
 	}
 	(void)closedir(dirp);
 }
-/**
- * read the first line of command's output
- *
- *	@param[in]	com	command line
- *	@param[in]	sb	string buffer
- *	@return			0: normal, -1: error
- */
-int
-read_first_line(const char *com, STRBUF *sb)
-{
-	FILE *ip = popen(com, "r");
-	char *p;
-
-	if (ip == NULL)
-		return -1;
-	p = strbuf_fgets(sb, ip, STRBUF_NOCRLF);
-	pclose(ip);
-	return (p == NULL) ? -1 : 0;
-}
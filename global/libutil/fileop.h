@@ -45,6 +45,5 @@ FILE *get_descripter(FILEOP *);
 void close_file(FILEOP *);
 void copyfile(const char *, const char *);
 void copydirectory(const char *, const char *);
-int read_first_line(const char *, STRBUF *);
 
 #endif /* ! _FILEOP_H */
@@ -62,6 +62,7 @@
 #include "makepath.h"
 #include "path.h"
 #include "strbuf.h"
+#include "strhash.h"
 #include "strlimcpy.h"
 #include "test.h"
 #include "varray.h"
@@ -94,8 +95,32 @@
  *	find_close();
  *
  */
-static regex_t *skip;			/**< regex for skipping units */
-static regex_t *suff;			/**< regex for suffixes */
+/**
+ * Compiled skip list.
+ *
+ * Most entries of the skip list are plain names like 'CVS/' or 'tags',
+ * or suffixes like '*.o'. They are looked up in hash tables instead of
+ * being matched by a regular expression. Only the other entries are
+ * compiled into a regular expression.
+ */
+struct skip_matcher {
+	int icase;			/**< ignore case */
+	int dotfiles;			/**< skip files which start with '.' */
+	STRHASH *names;			/**< 'name' and 'dir/' following '/' */
+	STRHASH *rooted;		/**< '/name' and '/dir/' following "./" */
+	STRHASH *suffixes;		/**< '*suffix' at the end of the path */
+	VARRAY *suffix_lengths;		/**< lengths of the suffixes */
+	regex_t *regex;			/**< the other entries */
+};
+/**
+ * Compiled suffix list of source files.
+ */
+struct suff_matcher {
+	int icase;			/**< ignore case */
+	STRHASH *suffixes;		/**< suffixes following '.' */
+};
+static struct skip_matcher *skip;	/**< matcher for skipping units */
+static struct suff_matcher *suff;	/**< matcher for suffixes */
 static FILE *ip;
 static FILE *temp;
 static char rootdir[PATH_MAX];
@@ -171,27 +196,60 @@ getreason(const char *path)
 	return is_directory << 8 | type;
 }
 /**
- * prepare_source: preparing regular expression.
+ * copy_path: copy a path name, lowering the case if needed.
  *
- *	@return	compiled regular expression for source files.
+ *	@param[in]	sb	buffer
+ *	@param[in]	path	path name
+ *	@param[in]	icase	1: lower the case
+ *	@return		copied path name
+ */
+static char *
+copy_path(STRBUF *sb, const char *path, int icase)
+{
+	strbuf_reset(sb);
+	if (icase) {
+		for (; *path; path++)
+			strbuf_putc(sb, tolower((unsigned char)*path));
+	} else {
+		strbuf_puts(sb, path);
+	}
+	return strbuf_value(sb);
+}
+/**
+ * get_icase_path: whether or not path names are case insensitive.
  */
-static regex_t *
+static int
+get_icase_path(void)
+{
+#if defined(_WIN32) || defined(__DJGPP__)
+	return 1;
+#else
+	return getconfb("icase_path");
+#endif
+}
+/**
+ * prepare_source: preparing suffix matcher.
+ *
+ *	@return	compiled suffix list for source files.
+ *
+ * The suffixes of the langmap are stored into a hash table.
+ * A path is a source file if the string following any '.' in it
+ * is one of the suffixes.
+ */
+static struct suff_matcher *
 prepare_source(void)
 {
-	static regex_t suff_area;
+	static struct suff_matcher suff_area;
 	STRBUF *sb = strbuf_open(0);
+	STRBUF *key = strbuf_open(0);
 	char *sufflist = NULL;
 	char *langmap = NULL;
-	int flags = REG_EXTENDED;
+	const char *suffp;
 
 	/*
 	 * load icase_path option.
 	 */
-	if (getconfb("icase_path"))
-		flags |= REG_ICASE;
-#if defined(_WIN32) || defined(__DJGPP__)
-	flags |= REG_ICASE;
-#endif
+	suff_area.icase = get_icase_path();
 	/*
 	 * make suffix list.
 	 */
@@ -203,32 +261,20 @@ prepare_source(void)
 	make_suffixes(langmap ? langmap : DEFAULTLANGMAP, sb);
 	sufflist = check_strdup(strbuf_value(sb));
 	trim(sufflist);
-	{
-		const char *suffp;
+	suff_area.suffixes = strhash_open(32);
+	for (suffp = sufflist; suffp; ) {
+		const char *p;
 
-		strbuf_reset(sb);
-		strbuf_puts(sb, "\\.(");       /* ) */
-		for (suffp = sufflist; suffp; ) {
-			const char *p;
-
-			for (p = suffp; *p && *p != ','; p++) {
-				if (!isalnum((unsigned char)*p))
-					strbuf_putc(sb, '\\');
-				strbuf_putc(sb, *p);
-			}
-			if (!*p)
-				break;
-			assert(*p == ',');
-			strbuf_putc(sb, '|');
-			suffp = ++p;
-		}
-		strbuf_puts(sb, ")$");
-		/*
-		 * compile regular expression.
-		 */
-		if (regcomp(&suff_area, strbuf_value(sb), flags) != 0)
-			die("cannot compile regular expression.");
+		strbuf_reset(key);
+		for (p = suffp; *p && *p != ','; p++)
+			strbuf_putc(key, suff_area.icase ? tolower((unsigned char)*p) : *p);
+		strhash_assign(suff_area.suffixes, strbuf_value(key), 1);
+		if (!*p)
+			break;
+		assert(*p == ',');
+		suffp = ++p;
 	}
+	strbuf_close(key);
 	strbuf_close(sb);
 	if (langmap)
 		free(langmap);
@@ -237,31 +283,78 @@ prepare_source(void)
 	return &suff_area;
 }
 /**
- * prepare_skip: prepare skipping files.
+ * add_skip_entry: add an entry of the skip list to the matcher.
  *
- *	Globals used (output):
- *		listarray[]: 	skip list.
- *		list_count:	 count of skip list.
+ *	@param[in]	sm	skip matcher
+ *	@param[in]	entry	entry of the skip list
+ *	@return		1: added, 0: the entry should be matched by regex
+ */
+static int
+add_skip_entry(struct skip_matcher *sm, const char *entry)
+{
+	STATIC_STRBUF(sb);
+	STRHASH *sh = sm->names;
+	const char *p;
+	int len;
+
+	if (*entry == '/') {
+		sh = sm->rooted;
+		entry++;
+	}
+	if (*entry == '\0')
+		return 0;
+	/*
+	 * '*suffix' (not for directories)
+	 */
+	if (*entry == '*' && sh == sm->names) {
+		p = entry + 1;
+		if (*p == '\0' || strpbrk(p, "*?[\\/"))
+			return 0;
+		len = strlen(p);
+		if (strhash_assign(sm->suffixes, copy_path(sb, p, sm->icase), 0) == NULL) {
+			int i, *lp;
+
+			strhash_assign(sm->suffixes, strbuf_value(sb), 1);
+			for (i = 0; i < sm->suffix_lengths->length; i++)
+				if (*(int *)varray_assign(sm->suffix_lengths, i, 0) == len)
+					break;
+			if (i == sm->suffix_lengths->length) {
+				lp = varray_append(sm->suffix_lengths);
+				*lp = len;
+			}
+		}
+		return 1;
+	}
+	/*
+	 * 'name' or 'dir/'
+	 */
+	if (strpbrk(entry, "*?[\\"))
+		return 0;
+	strhash_assign(sh, copy_path(sb, entry, sm->icase), 1);
+	return 1;
+}
+/**
+ * prepare_skip: prepare skipping files.
  *
- *	@return	compiled regular expression for skip files.
+ *	@return	compiled skip list.
  */
-static regex_t *
+static struct skip_matcher *
 prepare_skip(void)
 {
-	static regex_t skip_area;
+	static struct skip_matcher skip_area;
+	static regex_t regex_area;
 	char *skiplist;
 	STRBUF *reg = strbuf_open(0);
 	char *p, *q;
 	int flags = REG_EXTENDED|REG_NEWLINE;
+	int count = 0;
 
 	/*
 	 * load icase_path option.
 	 */
-	if (getconfb("icase_path"))
+	skip_area.icase = get_icase_path();
+	if (skip_area.icase)
 		flags |= REG_ICASE;
-#if defined(_WIN32) || defined(__DJGPP__)
-	flags |= REG_ICASE;
-#endif
 	/*
 	 * load skip data.
 	 */
@@ -274,25 +367,28 @@ prepare_skip(void)
 		fprintf(stderr, "DBG: Original skip list:\n%s\n", skiplist);
 	/* trim(skiplist);*/
 	strbuf_reset(reg);
-	/*
-	 * construct regular expression.
-	 */
-	strbuf_putc(reg, '(');	/* ) */
+	skip_area.names = strhash_open(64);
+	skip_area.rooted = strhash_open(16);
+	skip_area.suffixes = strhash_open(64);
+	skip_area.suffix_lengths = varray_open(sizeof(int), 16);
+	skip_area.regex = NULL;
 	/*
 	 * Hard coded skip files:
 	 * (1) files which start with '.'
 	 * (2) tag files
 	 */
 	/* skip files which start with '.' e.g. .cvsignore */
-	if (!accept_dotfiles) {
-		strbuf_puts(reg, "/\\.[^/]+$|");
-		strbuf_puts(reg, "/\\.[^/]+/|");
-	}
+	skip_area.dotfiles = !accept_dotfiles;
 	/* skip tag files */
-	strbuf_puts(reg, "/GTAGS$|");
-	strbuf_puts(reg, "/GRTAGS$|");
-	strbuf_puts(reg, "/GSYMS$|");
-	strbuf_puts(reg, "/GPATH$|");
+	add_skip_entry(&skip_area, "GTAGS");
+	add_skip_entry(&skip_area, "GRTAGS");
+	add_skip_entry(&skip_area, "GSYMS");
+	add_skip_entry(&skip_area, "GPATH");
+	/*
+	 * construct regular expression for the entries which cannot be
+	 * stored into the hash tables.
+	 */
+	strbuf_putc(reg, '(');	/* ) */
 	for (p = skiplist; *p; ) {
 		char *skipf;
 		STATIC_STRBUF(sb);
@@ -310,6 +406,10 @@ prepare_skip(void)
 			strbuf_putc(sb, *p);
 		}
 		skipf = strbuf_value(sb);
+		if (add_skip_entry(&skip_area, skipf))
+			continue;
+		if (count++ > 0)
+			strbuf_putc(reg, '|');
 		/* '/' means project root directory */
 		if (*skipf == '/') {
 			strbuf_puts(reg, "^\\./");
@@ -377,23 +477,109 @@ prepare_skip(void)
 		}
 		if (*(q - 1) != '/')
 			strbuf_putc(reg, '$');
-		if (*p == ',')
-			strbuf_putc(reg, '|');
 	}
-	strbuf_unputc(reg, '|');
 	strbuf_putc(reg, ')');
 	/*
 	 * compile regular expression.
 	 */
-	if (debug)
-		fprintf(stderr, "DBG: Regular expression of the skip list:\n%s\n", strbuf_value(reg));
-	if (regcomp(&skip_area, strbuf_value(reg), flags) != 0)
-		die("cannot compile regular expression.");
+	if (count > 0) {
+		if (debug)
+			fprintf(stderr, "DBG: Regular expression of the skip list:\n%s\n", strbuf_value(reg));
+		if (regcomp(&regex_area, strbuf_value(reg), flags) != 0)
+			die("cannot compile regular expression.");
+		skip_area.regex = &regex_area;
+	}
 	strbuf_close(reg);
 	free(skiplist);
 
 	return &skip_area;
 }
+/**
+ * match_skip: match a path name with the skip list.
+ *
+ *	@param[in]	sm	skip matcher
+ *	@param[in]	path	path name (must start with "./")
+ *	@param[out]	m	matched part
+ *	@return		1: matched, 0: not matched
+ */
+static int
+match_skip(struct skip_matcher *sm, const char *path, regmatch_t *m)
+{
+	STATIC_STRBUF(sb);
+	char *buf = copy_path(sb, path, sm->icase);
+	int len = strlen(buf);
+	int i, j;
+
+	/*
+	 * '/.name$' or '/.name/'
+	 */
+	if (sm->dotfiles) {
+		for (i = 0; i < len; i++) {
+			if (buf[i] == '/' && buf[i + 1] == '.' && buf[i + 2] && buf[i + 2] != '/') {
+				for (j = i + 2; buf[j] && buf[j] != '/'; j++)
+					;
+				m->rm_so = i;
+				m->rm_eo = buf[j] ? j + 1 : j;
+				return 1;
+			}
+		}
+	}
+	/*
+	 * 'name' and 'dir/' following a '/'. '/name' and '/dir/'
+	 * following the leading "./".
+	 */
+	for (i = 0; i < len; i++) {
+		int rooted;
+
+		if (buf[i] != '/')
+			continue;
+		rooted = (i == 1 && buf[0] == '.');
+		for (j = i + 1; j <= len; j++) {
+			int c, end, found;
+
+			if (j < len && buf[j] != '/')
+				continue;
+			if (j == len && buf[len - 1] == '/')
+				break;
+			/* 'dir/' ends with the '/', and 'name' ends at the end of the path */
+			end = (j < len) ? j + 1 : len;
+			c = buf[end];
+			buf[end] = '\0';
+			found = strhash_assign(sm->names, buf + i + 1, 0) != NULL
+				|| (rooted && strhash_assign(sm->rooted, buf + i + 1, 0) != NULL);
+			buf[end] = c;
+			if (found) {
+				m->rm_so = i;
+				m->rm_eo = end;
+				return 1;
+			}
+		}
+	}
+	/*
+	 * '*suffix' at the end of the last component.
+	 */
+	if (len > 0 && buf[len - 1] != '/' && sm->suffix_lengths->length > 0) {
+		int *lengths = varray_assign(sm->suffix_lengths, 0, 0);
+		const char *base = strrchr(buf, '/');
+
+		base = base ? base + 1 : buf;
+		for (i = 0; i < sm->suffix_lengths->length; i++) {
+			const char *suffix = buf + len - lengths[i];
+
+			if (suffix >= base && strhash_assign(sm->suffixes, suffix, 0)) {
+				m->rm_so = base - buf - 1;
+				m->rm_eo = len;
+				return 1;
+			}
+		}
+	}
+	/*
+	 * the other entries.
+	 */
+	if (sm->regex && regexec(sm->regex, path, 1, m, 0) == 0)
+		return 1;
+	return 0;
+}
 /**
  * issourcefile: check whether or not a source file.
  *
@@ -408,8 +594,14 @@ issourcefile(const char *path)
 		if (suff == NULL)
 			die("prepare_source failed.");
 	}
-	if (regexec(suff, path, 0, 0, 0) == 0)
-		return 1;
+	{
+		STATIC_STRBUF(sb);
+		const char *p = copy_path(sb, path, suff->icase);
+
+		for (; (p = strchr(p, '.')) != NULL; p++)
+			if (strhash_assign(suff->suffixes, p + 1, 0) != NULL)
+				return 1;
+	}
 	return 0;
 }
 /**
@@ -437,7 +629,7 @@ skipthisfile(const char *path)
 		if (skip == NULL)
 			die("prepare_skip failed.");
 	}
-	if (regexec(skip, path, 1, &m, 0) == 0) {
+	if (match_skip(skip, path, &m)) {
 		if (debug) {
 			int len = strlen(path);
 			fprintf(stderr, "DBG: ");
@@ -908,9 +1100,18 @@ find_close(void)
 	} else {
 		die("find_close: internal error.");
 	}
-	if (suff)
-		regfree(suff);
-	if (skip)
-		regfree(skip);
+	if (suff) {
+		strhash_close(suff->suffixes);
+		suff = NULL;
+	}
+	if (skip) {
+		strhash_close(skip->names);
+		strhash_close(skip->rooted);
+		strhash_close(skip->suffixes);
+		varray_close(skip->suffix_lengths);
+		if (skip->regex)
+			regfree(skip->regex);
+		skip = NULL;
+	}
 	find_eof = find_mode = 0;
 }
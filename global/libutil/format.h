@@ -56,6 +56,33 @@
  *
  * +----------------------------------------------
  * |./src/main.c main 227 main()
+ *
+ * (8) JSON format (FORMAT_JSON)
+ *
+ * One JSON object per line (NDJSON). The first line is a header and
+ * the last line has the number of records. They are put once for an
+ * invocation even if library trees are searched too. The file id is
+ * unique in the tree given as "root".
+ * Strings are put as is if they are well-formed UTF-8. Other bytes of
+ * 0x80 or over are taken as Latin-1 and escaped as \u0080-\u00ff.
+ * +----------------------------------------------
+ * |{"format":"global-result","version":1}
+ * |{"root":"/usr/src","fid":110,"path":"./src/main.c","line":227,"tag":"main","image":"main()"}
+ * |{"count":1}
+ *
+ * (9) binary format (FORMAT_BINARY)
+ *
+ * All integers are 32-bit unsigned, in network byte order.
+ * Strings are length-prefixed and not terminated by '\0'.
+ * +----------------------------------------------
+ * |"GRES" <version>				header
+ * |<length> <fid> <line> <root> <path> <tag> <image>	record
+ * |...
+ * |0 <count>					trailer
+ *
+ * <length> is the number of bytes of the record which follow it,
+ * and <root>, <path>, <tag> and <image> are <length of string> <string>.
+ * As in the JSON format, <fid> is unique in the tree <root>.
  */
 #define FORMAT_CTAGS		1
 #define FORMAT_CTAGS_X		2
@@ -64,6 +91,8 @@
 #define FORMAT_PATH		5
 #define FORMAT_GREP		6
 #define FORMAT_CSCOPE		7
+#define FORMAT_JSON		8
+#define FORMAT_BINARY		9
 
 /*
  * FORMAT_CTAGS_X
@@ -44,7 +44,9 @@
 #include "idset.h"
 #include "is_unixy.h"
 #include "langmap.h"
+#include "libpath.h"
 #include "linetable.h"
+#include "lnolist.h"
 #include "locatestring.h"
 #include "logging.h"
 #include "makepath.h"
@@ -53,6 +55,7 @@
 #include "pool.h"
 #include "rewrite.h"
 #include "split.h"
+#include "srcline.h"
 #include "statistics.h"
 #include "strbuf.h"
 #include "strhash.h"
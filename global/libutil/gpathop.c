@@ -22,6 +22,7 @@
 #include <config.h>
 #endif
 #include <assert.h>
+#include <ctype.h>
 #ifdef STDC_HEADERS
 #include <stdlib.h>
 #endif
@@ -39,8 +40,10 @@
 #include "gpathop.h"
 #include "makepath.h"
 #include "nearsort.h"
+#include "pool.h"
 #include "strbuf.h"
 #include "strlimcpy.h"
+#include "varray.h"
 
 static DBOP *dbop;
 static int _nextkey;
@@ -48,6 +51,19 @@ static int _mode;
 static int opened;
 static int created;
 
+/*
+ * Cache for gpath_fid2path().
+ *
+ * Since file ids are dense numbers, the paths once read from GPATH
+ * are kept in an array indexed by the file id.
+ */
+struct fid2path {
+	const char *path;		/**< path name, NULL: not cached */
+	int type;			/**< GPATH_SOURCE or GPATH_OTHER */
+};
+static VARRAY *fid2path_cache;
+static POOL *fid2path_pool;
+
 int openflags;
 void
 set_gpath_flags(int flags) {
@@ -81,6 +97,7 @@ compare_nearpath(const void *s1, const void *s2)
  * GLOBAL-4.8.7		no idea about format version.
  * GLOBAL-5.0		understand format version.
  *			support format version 2.
+ * GLOBAL-6.5.5		support format version 3, and read version 2.
  *
  * - Format version 1
  *
@@ -100,9 +117,22 @@ compare_nearpath(const void *s1, const void *s2)
  *      --------------------
  *      ./aaa.c\0       11\0
  *      ./README\0      12\0o\0         <=== 'o' means other files.
+ *
+ * - Format version 3
+ *
+ * The path name record of a source file has the time when gtags began
+ * to read the file as the flag (see gpath_putstamp()).
+ * When a GPATH of version 2 is updated, no stamp is put to it.
+ *
+ *      key             data
+ *      --------------------
+ *      ./aaa.c\0       11\01792410673\0 <=== the time of parsing.
+ *      ./README\0      12\0o\0         <=== 'o' means other files.
  */
-static int support_version = 2;	/**< acceptable format version   */
-static int create_version = 2;	/**< format version of newly created tag file */
+static int support_version = 3;	/**< acceptable format version   */
+static int compat_version = 2;	/**< oldest acceptable format version */
+static int create_version = 3;	/**< format version of newly created tag file */
+static int _version;		/**< format version of the opened GPATH */
 /**
  * gpath_open: open gpath tag file
  *
@@ -133,18 +163,18 @@ gpath_open(const char *dbpath, int mode)
 		return -1;
 	if (mode == 1) {
 		dbop_putversion(dbop, create_version);
+		_version = create_version;
 		_nextkey = 1;
 	} else {
-		int format_version;
 		const char *path = dbop_get(dbop, NEXTKEY);
 
 		if (path == NULL)
 			die("nextkey not found in GPATH.");
 		_nextkey = atoi(path);
-		format_version = dbop_getversion(dbop);
-		if (format_version > support_version)
+		_version = dbop_getversion(dbop);
+		if (_version > support_version)
 			die("GPATH seems new format. Please install the latest GLOBAL.");
-		else if (format_version < support_version)
+		else if (_version < compat_version)
                         die("GPATH seems older format. Please remake tag files."); 
 	}
 	opened++;
@@ -186,6 +216,63 @@ gpath_put(const char *path, int type)
 	strbuf_puts(sb, path);
 	dbop_put_path(dbop, fid, strbuf_value(sb), type == GPATH_OTHER ? "o" : NULL);
 }
+/**
+ * gpath_putstamp: put path name of a source file with the time of parsing
+ *
+ *	@param[in]	path	path name of a source file
+ *	@param[in]	stamp	time when gtags begins to read the file
+ *
+ * This is gpath_put(path, GPATH_SOURCE) which also keeps the stamp as
+ * the flag of the path name record ("./..."). The record of a known
+ * path is rewritten. A file modified at or after the stamp may not be
+ * reflected in the tag files.
+ */
+void
+gpath_putstamp(const char *path, time_t stamp)
+{
+	char fid[MAXFIDLEN], flag[32];
+	const char *p;
+
+	assert(opened > 0);
+	if (_mode == 1 && created)
+		return;
+	if (_version < 3) {
+		gpath_put(path, GPATH_SOURCE);
+		return;
+	}
+	if ((p = dbop_get(dbop, path)) != NULL) {
+		strlimcpy(fid, p, sizeof(fid));
+		dbop_delete(dbop, path);
+	} else {
+		/*
+		 * fid => path mapping.
+		 */
+		snprintf(fid, sizeof(fid), "%d", _nextkey++);
+		dbop_put_path(dbop, fid, path, NULL);
+	}
+	/*
+	 * path => fid mapping.
+	 */
+	snprintf(flag, sizeof(flag), "%ld", (long)stamp);
+	dbop_put_path(dbop, path, fid, flag);
+}
+/**
+ * gpath_getstamp: return the time when the file was parsed
+ *
+ *	@param[in]	path	path name of a source file
+ *	@return		stamp, 0: unknown
+ */
+time_t
+gpath_getstamp(const char *path)
+{
+	const char *flag;
+
+	assert(opened > 0);
+	if (dbop_get(dbop, path) == NULL)
+		return 0;
+	flag = dbop_getflag(dbop);
+	return isdigit((unsigned char)*flag) ? (time_t)atol(flag) : 0;
+}
 /**
  * gpath_path2fid: convert path into id
  *
@@ -219,12 +306,45 @@ gpath_path2fid(const char *path, int *type)
 const char *
 gpath_fid2path(const char *fid, int *type)
 {
-	const char *path = dbop_get(dbop, fid);
+	struct fid2path *entry = NULL;
+	const char *path, *flag;
+	int id = atoi(fid);
+
 	assert(opened > 0);
-	if (path && type) {
-		const char *flag = dbop_getflag(dbop);
-		*type = (*flag == 'o') ? GPATH_OTHER : GPATH_SOURCE;
+	/*
+	 * Only valid file ids are cached, so that a broken or
+	 * foreign id cannot grow the cache.
+	 */
+	if (id > 0 && id < _nextkey) {
+		if (fid2path_cache == NULL) {
+			fid2path_cache = varray_open(sizeof(struct fid2path), _nextkey > 1000 ? _nextkey : 1000);
+			fid2path_pool = pool_open();
+		}
+		if (id >= fid2path_cache->length) {
+			int i = fid2path_cache->length;
+
+			varray_assign(fid2path_cache, id, 1);
+			for (; i <= id; i++)
+				((struct fid2path *)varray_assign(fid2path_cache, i, 0))->path = NULL;
+		}
+		entry = varray_assign(fid2path_cache, id, 0);
+		if (entry->path) {
+			if (type)
+				*type = entry->type;
+			return entry->path;
+		}
+	}
+	path = dbop_get(dbop, fid);
+	if (path == NULL)
+		return NULL;
+	flag = dbop_getflag(dbop);
+	if (entry) {
+		entry->path = pool_strdup(fid2path_pool, path, 0);
+		entry->type = (*flag == 'o') ? GPATH_OTHER : GPATH_SOURCE;
+		path = entry->path;
 	}
+	if (type)
+		*type = (*flag == 'o') ? GPATH_OTHER : GPATH_SOURCE;
 	return path;
 }
 /**
@@ -243,6 +363,8 @@ gpath_delete(const char *path)
 	fid = dbop_get(dbop, path);
 	if (fid == NULL)
 		return;
+	if (fid2path_cache && atoi(fid) > 0 && atoi(fid) < fid2path_cache->length)
+		((struct fid2path *)varray_assign(fid2path_cache, atoi(fid), 0))->path = NULL;
 	dbop_delete(dbop, fid);
 	dbop_delete(dbop, path);
 }
@@ -268,6 +390,12 @@ gpath_close(void)
 	assert(opened > 0);
 	if (--opened > 0)
 		return;
+	if (fid2path_cache) {
+		varray_close(fid2path_cache);
+		pool_close(fid2path_pool);
+		fid2path_cache = NULL;
+		fid2path_pool = NULL;
+	}
 	if (_mode == 1 && created) {
 		dbop_close(dbop);
 		return;
@@ -281,6 +409,70 @@ gpath_close(void)
 		created = 1;
 }
 
+/*
+ * GPATH context.
+ *
+ * Only one GPATH is used at a time in a process. A program which keeps
+ * the tag files of two or more projects open (gtags-cscope with
+ * GTAGSLIBPATH) detaches the GPATH of a project with gpath_detach(),
+ * and attaches it again with gpath_attach() before using its tag files.
+ */
+struct gpath_context {
+	DBOP *dbop;
+	int nextkey;
+	int opened;
+	VARRAY *fid2path_cache;
+	POOL *fid2path_pool;
+};
+/**
+ * gpath_detach: detach the opened GPATH (read only).
+ *
+ *	@return		context of the GPATH, NULL: GPATH is not opened
+ *
+ * After this, gpath_open() can open another GPATH.
+ */
+GPATH_CONTEXT *
+gpath_detach(void)
+{
+	GPATH_CONTEXT *ctx;
+
+	if (opened == 0)
+		return NULL;
+	assert(_mode == 0);
+	ctx = (GPATH_CONTEXT *)check_malloc(sizeof(GPATH_CONTEXT));
+	ctx->dbop = dbop;
+	ctx->nextkey = _nextkey;
+	ctx->opened = opened;
+	ctx->fid2path_cache = fid2path_cache;
+	ctx->fid2path_pool = fid2path_pool;
+	dbop = NULL;
+	opened = 0;
+	fid2path_cache = NULL;
+	fid2path_pool = NULL;
+	return ctx;
+}
+/**
+ * gpath_attach: attach the GPATH detached by gpath_detach().
+ *
+ *	@param[in]	ctx	context of the GPATH (NULL: do nothing)
+ *
+ * No GPATH may be opened. The context is freed.
+ */
+void
+gpath_attach(GPATH_CONTEXT *ctx)
+{
+	if (ctx == NULL)
+		return;
+	assert(opened == 0);
+	dbop = ctx->dbop;
+	_nextkey = ctx->nextkey;
+	_mode = 0;
+	opened = ctx->opened;
+	fid2path_cache = ctx->fid2path_cache;
+	fid2path_pool = ctx->fid2path_pool;
+	free(ctx);
+}
+
 /**
  * GFIND *gfind_open(const char *dbpath, const char *local, int target, int flags)
  *
@@ -322,7 +514,7 @@ gfind_open(const char *dbpath, const char *local, int target, int flags)
 	gfind->version = dbop_getversion(gfind->dbop);
 	if (gfind->version > support_version)
 		die("GPATH seems new format. Please install the latest GLOBAL.");
-	else if (gfind->version < support_version)
+	else if (gfind->version < compat_version)
 		die("GPATH seems older format. Please remake tag files."); 
 	/*
 	 * Nearness sort.
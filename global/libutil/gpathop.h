@@ -21,6 +21,7 @@
 #ifndef _PATHOP_H_
 #define _PATHOP_H_
 #include <stdio.h>
+#include <time.h>
 
 #include "gparam.h"
 #include "dbop.h"
@@ -59,14 +60,20 @@ typedef struct {
 	const char *path;	/**< return value of gfind_read() */
 } GFIND;
 
+typedef struct gpath_context GPATH_CONTEXT;	/**< defined in gpathop.c */
+
 void set_gpath_flags(int);
 int gpath_open(const char *, int);
 const char *gpath_path2fid(const char *, int *);
 const char *gpath_fid2path(const char *, int *);
 void gpath_put(const char *, int);
+void gpath_putstamp(const char *, time_t);
+time_t gpath_getstamp(const char *);
 void gpath_delete(const char *);
 void gpath_close(void);
 int gpath_nextkey(void);
+GPATH_CONTEXT *gpath_detach(void);
+void gpath_attach(GPATH_CONTEXT *);
 GFIND *gfind_open(const char *, const char *, int, int);
 const char *gfind_read(GFIND *);
 void gfind_close(GFIND *);
@@ -47,6 +47,8 @@
 #include "getdbpath.h"
 #include "gparam.h"
 #include "gtagsop.h"
+#include "libpath.h"
+#include "lnolist.h"
 #include "locatestring.h"
 #include "makepath.h"
 #include "nearsort.h"
@@ -272,6 +274,8 @@ static const char *const tagslist[] = {"GPATH", "GTAGS", "GRTAGS", "GSYMS"};
 		if ((gtop->db == GRTAGS && !defined) || (gtop->db == GSYMS && defined))	\
 			continue;							\
 	}
+static char prev_name[MAXTOKEN+1];	/**< cache for is_defined_in_GTAGS() */
+static int prev_result;
 /**
  * is_defined_in_GTAGS: whether or not the name is defined in GTAGS.
  *
@@ -284,9 +288,6 @@ static const char *const tagslist[] = {"GPATH", "GTAGS", "GRTAGS", "GSYMS"};
 static int
 is_defined_in_GTAGS(GTOP *gtop, const char *name)
 {
-	static char prev_name[MAXTOKEN+1];
-	static int prev_result;
-
 	if (!strcmp(name, prev_name))
 		return prev_result;
 	strlimcpy(prev_name, name, sizeof(prev_name));
@@ -306,6 +307,130 @@ dbname(int db)
 	assert(db >= 0 && db < GTAGLIM);
 	return tagslist[db];
 }
+/*
+ * Line number pool for compact format.
+ *
+ * All line numbers of a file are appended to one array in arrival order
+ * with the index of their tag, and are gathered by tag at flush time with
+ * a counting sort, so each tag gets a contiguous slice of 'lines'.
+ * Tags are looked up with a string hash whose value is the index of the
+ * tag plus 1. Nothing is freed for each file; the hash and the arrays
+ * are only reset.
+ *
+ * hash		"funcA" => 1, "funcB" => 2, ...
+ * tags		|funcA: count=3 sorted|funcB: count=2 sorted|...
+ * occurrences	|A 1|A 3|B 2|A 7|B 5|...
+ * lines	|1|3|7|2|5|...		(after lno_pool_gather())
+ *		 ^funcA ^funcB
+ */
+struct lno_tag {
+	const char *name;		/**< tag name (in the hash) */
+	int count;			/**< number of line numbers */
+	int first;			/**< start of the slice in lines */
+	int last;			/**< last line number put */
+	int sorted;			/**< line numbers arrived in order */
+};
+struct lno_occurrence {
+	int tag;			/**< index of tags */
+	int lno;			/**< line number */
+};
+struct lno_pool {
+	STRHASH *hash;			/**< tag name => index of tags + 1 */
+	VARRAY *tags;			/**< struct lno_tag */
+	VARRAY *occurrences;		/**< struct lno_occurrence */
+	VARRAY *lines;			/**< int */
+};
+#define LNO_POOL_BUCKETS	1024
+
+static struct lno_pool *
+lno_pool_open(void)
+{
+	struct lno_pool *pool = (struct lno_pool *)check_calloc(sizeof(struct lno_pool), 1);
+
+	pool->hash = strhash_open(LNO_POOL_BUCKETS);
+	pool->tags = varray_open(sizeof(struct lno_tag), 1000);
+	pool->occurrences = varray_open(sizeof(struct lno_occurrence), 10000);
+	pool->lines = varray_open(sizeof(int), 10000);
+	return pool;
+}
+/**
+ * lno_pool_put: put a line number of a tag.
+ */
+static void
+lno_pool_put(struct lno_pool *pool, const char *tag, int lno)
+{
+	struct sh_entry *entry = strhash_assign(pool->hash, tag, 1);
+	struct lno_occurrence *occ;
+	struct lno_tag *t;
+
+	if (entry->value == NULL) {
+		/* new tag */
+		t = varray_append(pool->tags);
+		t->name = entry->name;
+		t->count = 0;
+		t->last = 0;
+		t->sorted = 1;
+		entry->value = (void *)(long)pool->tags->length;
+	} else
+		t = varray_assign(pool->tags, (long)entry->value - 1, 0);
+	if (lno < t->last)
+		t->sorted = 0;
+	t->last = lno;
+	t->count++;
+	occ = varray_append(pool->occurrences);
+	occ->tag = (long)entry->value - 1;
+	occ->lno = lno;
+}
+/**
+ * lno_pool_gather: arrange line numbers in slices of each tag.
+ *
+ * This is a counting sort which keeps the arrival order in each tag.
+ */
+static void
+lno_pool_gather(struct lno_pool *pool)
+{
+	struct lno_tag *tags;
+	struct lno_occurrence *occ;
+	int *lines;
+	int t, i, first = 0;
+
+	if (pool->occurrences->length == 0)
+		return;
+	tags = varray_assign(pool->tags, 0, 0);
+	for (t = 0; t < pool->tags->length; t++) {
+		tags[t].first = first;
+		first += tags[t].count;
+		tags[t].count = 0;	/* counted again below */
+	}
+	/* make room for all the line numbers */
+	(void)varray_assign(pool->lines, pool->occurrences->length - 1, 1);
+	lines = varray_assign(pool->lines, 0, 0);
+	occ = varray_assign(pool->occurrences, 0, 0);
+	for (i = 0; i < pool->occurrences->length; i++) {
+		t = occ[i].tag;
+		lines[tags[t].first + tags[t].count++] = occ[i].lno;
+	}
+}
+/**
+ * lno_pool_reset: forget all tags (for the next file).
+ */
+static void
+lno_pool_reset(struct lno_pool *pool)
+{
+	strhash_reset(pool->hash);
+	varray_reset(pool->tags);
+	varray_reset(pool->occurrences);
+	varray_reset(pool->lines);
+}
+static void
+lno_pool_close(struct lno_pool *pool)
+{
+	strhash_close(pool->hash);
+	varray_close(pool->tags);
+	varray_close(pool->occurrences);
+	varray_close(pool->lines);
+	free(pool);
+}
 /**
  * gtags_open: open global tag.
  *
@@ -328,6 +453,10 @@ gtags_open(const char *dbpath, const char *root, int db, int mode, int flags)
 	int dbmode;
 	int dbop_flags = DBOP_DUP;
 
+	/*
+	 * The cache of is_defined_in_GTAGS() may be older than GTAGS.
+	 */
+	prev_name[0] = '\0';
 	gtop = (GTOP *)check_calloc(sizeof(GTOP), 1);
 	gtop->db = db;
 	gtop->mode = mode;
@@ -457,7 +586,7 @@ gtags_open(const char *dbpath, const char *root, int db, int mode, int flags)
 		assert(root != NULL);
 		strlimcpy(gtop->root, root, sizeof(gtop->root));
 		if (gtop->mode != GTAGS_READ)
-			gtop->path_hash = strhash_open(HASHBUCKETS);
+			gtop->lno_pool = lno_pool_open();
 	}
 	return gtop;
 }
@@ -476,23 +605,11 @@ gtags_put_using(GTOP *gtop, const char *tag, int lno, const char *fid, const cha
 	const char *key;
 
 	if (gtop->format & GTAGS_COMPACT) {
-		struct sh_entry *entry;
-
 		/*
 		 * Register each record into the pool.
-		 *
-		 * Pool image:
-		 *
-		 * tagname   lno
-		 * ------------------------------
-		 * "funcA"   | 1| 3| 7|23|11| 2|...
-		 * "funcB"   |34| 2| 5|66| 3|...
-		 * ...
+		 * See lno_pool_put() for the details.
 		 */
-		entry = strhash_assign(gtop->path_hash, tag, 1);
-		if (entry->value == NULL)
-			entry->value = varray_open(sizeof(int), 100);
-		*(int *)varray_append((VARRAY *)entry->value) = lno;
+		lno_pool_put(gtop->lno_pool, tag, lno);
 		return;
 	}
 	/*
@@ -534,7 +651,7 @@ gtags_flush(GTOP *gtop, const char *fid)
 {
 	if (gtop->format & GTAGS_COMPACT) {
 		flush_pool(gtop, fid);
-		strhash_reset(gtop->path_hash);
+		lno_pool_reset(gtop->lno_pool);
 	}
 }
 /**
@@ -577,6 +694,46 @@ gtags_delete(GTOP *gtop, IDSET *deleteset)
 			dbop_delete(gtop->dbop, NULL);
 	}
 }
+/*
+ * Case-insensitive search is done by prefix reads for each combination of
+ * the case of the letters in the prefix. The prefix is upper case at first,
+ * and gtags_restart() changes it into the next combination in the order of
+ * the key. The number of letters is limited so as not to make too many reads.
+ */
+#define CASE_LETTERS_LIMIT	6
+/**
+ * upper_prefix: make the first prefix for case-insensitive search.
+ *
+ *	@param[out]	buffer	prefix
+ *	@param[in]	size	size of buffer
+ *	@param[in]	p	literal part of the pattern
+ *	@return		buffer
+ */
+static char *
+upper_prefix(char *buffer, int size, const char *p)
+{
+	char *q = buffer;
+	int letters = 0;
+
+	for (; *p && q < buffer + size - 1; p++) {
+		int c = (unsigned char)*p;
+
+		/*
+		 * The case of a non-ASCII character is left to the regular
+		 * expression, except for the head as before.
+		 */
+		if (c >= 0x80) {
+			if (q == buffer)
+				*q++ = toupper(c);
+			break;
+		}
+		if (toupper(c) != tolower(c) && ++letters > CASE_LETTERS_LIMIT)
+			break;
+		*q++ = toupper(c);
+	}
+	*q = 0;
+	return buffer;
+}
 /**
  * get_prefix: get as long prefix of the pattern as possible.
  *
@@ -594,8 +751,7 @@ get_prefix(const char *pattern, int flags)
 		prefix = NULL;
 	} else if (flags & GTOP_NOREGEX || !isregex(pattern)) {
 		if (flags & GTOP_IGNORECASE) {
-			buffer[0] = toupper(*pattern);
-			buffer[1] = 0;
+			upper_prefix(buffer, sizeof(buffer), pattern);
 		} else {
 			prefix = NULL;
 		}
@@ -615,10 +771,9 @@ get_prefix(const char *pattern, int flags)
 		if (*p == 0 || isregex(p)) {
 			prefix = NULL;
 		} else {
-			if (flags & GTOP_IGNORECASE) {
-				prefix[0] = toupper(*p);
-				prefix[1] = 0;
-			} else
+			if (flags & GTOP_IGNORECASE)
+				upper_prefix(buffer, sizeof(buffer), p);
+			else
 				strlimcpy(buffer, p, sizeof(buffer));
 		}
 		if (save)
@@ -627,34 +782,71 @@ get_prefix(const char *pattern, int flags)
 	return prefix;
 }
 /**
- * gtags_restart: restart dbop iterator using lower case prefix.
+ * gtags_restart: restart dbop iterator using the next case of the prefix.
  *
  *	@param[in]	gtop	GTOP structure
  *	@return		prepared or not
  *			0:	cannot continue
  *			1:	can continue
+ *
+ * The case of the letters is counted up like a binary number
+ * (upper case: 0, lower case: 1) from the tail of the prefix.
  */
 static int
 gtags_restart(GTOP *gtop)
 {
-	int upper, lower;
+	char *p;
 
 	if (gtop->prefix == NULL)
 		die("gtags_restart: impossible.");
-	upper = gtop->prefix[0];
-	lower = tolower(upper);
-	if (upper < lower) {
-		gtop->prefix[0] = lower;
-		gtop->key = gtop->prefix;
-		gtop->prefix = NULL;
-		if (gtop->openflags & GTAGS_DEBUG)
-			fprintf(stderr, "Using prefix: %s\n", gtop->key);
-		return 1;
+	for (p = gtop->prefix + strlen(gtop->prefix) - 1; p >= gtop->prefix; p--) {
+		int upper = toupper((unsigned char)*p);
+		int lower = tolower((unsigned char)*p);
+
+		if (upper >= lower)
+			continue;
+		if ((unsigned char)*p == upper) {
+			*p = lower;
+			gtop->key = gtop->prefix;
+			if (gtop->openflags & GTAGS_DEBUG)
+				fprintf(stderr, "Using prefix: %s\n", gtop->key);
+			return 1;
+		}
+		*p = upper;
 	}
 	if (gtop->openflags & GTAGS_DEBUG)
 		fprintf(stderr, "gtags_restart: not prepared.\n");
 	return 0;
 }
+/**
+ * gtags_setscope: restrict the records to files under a directory.
+ *
+ *	@param[in]	gtop	GTOP structure
+ *	@param[in]	dbpath	dbpath directory
+ *	@param[in]	local	local prefix (e.g. "./src/"),
+ *			if NULL specified, all files are the target
+ *
+ * The file ids under the directory are collected with a prefix read of
+ * GPATH, so that gtags_first() and gtags_next() can drop the other
+ * records before looking up the path names and sorting.
+ */
+void
+gtags_setscope(GTOP *gtop, const char *dbpath, const char *local)
+{
+	GFIND *gp;
+
+	if (gtop->scope) {
+		idset_close(gtop->scope);
+		gtop->scope = NULL;
+	}
+	if (local == NULL)
+		return;
+	gtop->scope = idset_open(gpath_nextkey());
+	gp = gfind_open(dbpath, local, GPATH_SOURCE, 0);
+	while (gfind_read(gp) != NULL)
+		idset_add(gtop->scope, atoi(gp->dbop->lastdat));
+	gfind_close(gp);
+}
 /**
  * gtags_first: return first record
  *
@@ -795,6 +987,8 @@ again0:
 		     tagline = dbop_next(gtop->dbop))
 		{
 			VIRTUAL_GRTAGS_GSYMS_PROCESSING(gtop);
+			if (gtop->scope && !idset_contains(gtop->scope, atoi(tagline)))
+				continue;
 			/* extract file id */
 			p = locatestring(tagline, " ", MATCH_FIRST);
 			if (p == NULL)
@@ -878,6 +1072,12 @@ again2:
 		 * Read a tag segment with sorting.
 		 */
 		segment_read(gtop);
+		if (gtop->gtp_count == 0) {
+			/* no record in the scope */
+			if (gtop->prefix && gtags_restart(gtop))
+				goto again2;
+			return NULL;
+		}
 		return  &gtop->gtp_array[gtop->gtp_index++];
 	}
 }
@@ -923,15 +1123,17 @@ again3:
 			/* strhash_reset(gtop->path_hash); */
 			segment_read(gtop);
 		}
-		if (gtop->gtp_index >= gtop->gtp_count) {
-			if (gtop->prefix && gtags_restart(gtop)) {
+		while (gtop->gtp_index >= gtop->gtp_count) {
+			gtop->gtp.tag = NULL;
+			while (gtop->prefix && gtags_restart(gtop)) {
 				gtop->gtp.tag = dbop_first(gtop->dbop, gtop->key, gtop->preg, gtop->dbflags);
-				if (gtop->gtp.tag == NULL)
-					return NULL;
-				dbop_unread(gtop->dbop);
-				segment_read(gtop);
-			} else
+				if (gtop->gtp.tag != NULL)
+					break;
+			}
+			if (gtop->gtp.tag == NULL)
 				return NULL;
+			dbop_unread(gtop->dbop);
+			segment_read(gtop);
 		}
 		return &gtop->gtp_array[gtop->gtp_index++];
 	}
@@ -962,12 +1164,120 @@ gtags_close(GTOP *gtop)
 		varray_close(gtop->vb);
 	if (gtop->path_hash)
 		strhash_close(gtop->path_hash);
+	if (gtop->lno_pool)
+		lno_pool_close(gtop->lno_pool);
+	if (gtop->scope)
+		idset_close(gtop->scope);
 	gpath_close();
 	dbop_close(gtop->dbop);
 	if (gtop->gtags)
 		dbop_close(gtop->gtags);
 	free(gtop);
 }
+/**
+ * decide_tag_by_context: decide tag type by context
+ *
+ *	@param[in]	dbpath	dbpath directory
+ *	@param[in]	tag	tag name
+ *	@param[in]	path	context file (normalized path name: ./...)
+ *	@param[in]	lineno	context lineno
+ *	@return		GTAGS, GRTAGS, GSYMS, NOTAGS: the context is not found
+ *
+ * If the tag is not defined in the current tree, the library trees in
+ * GTAGSLIBPATH are examined too.
+ */
+int
+decide_tag_by_context(const char *dbpath, const char *tag, const char *path, int lineno)
+{
+	char s_fid[MAXFIDLEN];
+	const char *tagline, *p;
+	DBOP *dbop;
+	int db = GSYMS;
+	int format = 0;
+
+	/*
+	 * get file id
+	 */
+	if (gpath_open(dbpath, 0) < 0)
+		die("GPATH not found.");
+	if ((p = gpath_path2fid(path, NULL)) != NULL)
+		strlimcpy(s_fid, p, sizeof(s_fid));
+	gpath_close();
+	if (p == NULL)
+		return NOTAGS;
+	/*
+	 * read btree records directly to avoid the overhead.
+	 */
+	dbop = dbop_open(makepath(dbpath, dbname(GTAGS), NULL), 0, 0, 0);
+	if (dbop == NULL)
+		die("cannot open GTAGS.");
+	if (dbop_getoption(dbop, COMPACTKEY))
+		format |= GTAGS_COMPACT;
+	if (dbop_getoption(dbop, COMPLINEKEY))
+		format |= GTAGS_COMPLINE;
+	for (tagline = dbop_first(dbop, tag, NULL, 0); tagline; tagline = dbop_next(dbop)) {
+		db = GTAGS;
+		/*
+		 * examine whether the definition record include the context.
+		 */
+		p = locatestring(tagline, s_fid, MATCH_AT_FIRST);
+		if (p == NULL || *p != ' ')
+			continue;
+		for (p++; *p && *p != ' '; p++)
+			;
+		if (*p++ != ' ' || !isdigit((unsigned char)*p))
+			die("Impossible! decide_tag_by_context(1)");
+		/*
+		 * Standard format	n <blank> <image>$
+		 * Compact format	d,d,d,d$
+		 */
+		if (format & GTAGS_COMPACT) {
+			LNOLIST l;
+			int n;
+
+			/*
+			 * The line numbers are in ascending order in a record,
+			 * so we can stop reading the record at the first one
+			 * beyond lineno. But the line numbers of a file may be
+			 * split into two or more records, which don't come in
+			 * the order of line number.
+			 */
+			lnolist_open(&l, p, format & GTAGS_COMPLINE);
+			while ((n = lnolist_next(&l)) > 0 && n <= lineno)
+				if (n == lineno) {
+					db = GRTAGS;
+					goto finish;
+				}
+		} else if (atoi(p) == lineno) {
+			db = GRTAGS;
+			goto finish;
+		}
+	}
+finish:
+	dbop_close(dbop);
+	/*
+	 * search in library path.
+	 */
+	if (db == GSYMS && getenv("GTAGSLIBPATH")) {
+		VARRAY *vb = libpath_open(dbpath, GTAGS);
+		LIBTREE *trees = varray_assign(vb, 0, 0);
+		int i;
+
+		for (i = 0; i < vb->length; i++) {
+			dbop = dbop_open(makepath(trees[i].dbpath, dbname(GTAGS), NULL), 0, 0, 0);
+			if (dbop == NULL)
+				continue;
+			tagline = dbop_first(dbop, tag, NULL, 0);
+			dbop_close(dbop);
+			if (tagline != NULL) {
+				db = GTAGS;
+				break;
+			}
+		}
+		libpath_close(vb);
+	}
+	return db;
+}
 /**
  * flush_pool: flush and write the pool as compact format.
  *
@@ -977,20 +1287,23 @@ gtags_close(GTOP *gtop)
 static void
 flush_pool(GTOP *gtop, const char *s_fid)
 {
-	struct sh_entry *entry;
+	struct lno_pool *pool = gtop->lno_pool;
+	struct lno_tag *tags;
 	int header_offset;
-	int i, last;
+	int i, t, last;
 
 	if (s_fid == NULL)
 		die("flush_pool: impossible");
 	/*
-	 * Write records as compact format and free line number table
-	 * for each entry in the pool.
+	 * Write records as compact format for each tag in the pool.
 	 */
-	for (entry = strhash_first(gtop->path_hash); entry; entry = strhash_next(gtop->path_hash)) {
-		VARRAY *vb = (VARRAY *)entry->value;
-		int *lno_array = varray_assign(vb, 0, 0);
-		const char *key = entry->name;
+	lno_pool_gather(pool);
+	tags = varray_assign(pool->tags, 0, 0);
+	for (t = 0; t < pool->tags->length; t++) {
+		const char *name = tags[t].name;
+		int *lno_array = (int *)varray_assign(pool->lines, tags[t].first, 0);
+		int lno_count = tags[t].count;
+		const char *key = name;
 
 		/*
 		 * extract method when class method definition.
@@ -1001,23 +1314,24 @@ flush_pool(GTOP *gtop, const char *s_fid)
 		 * data = 'Class::method  103 ./class.cpp ...'
 		 */
 		if (gtop->flags & GTAGS_EXTRACTMETHOD) {
-			if ((key = locatestring(entry->name, ".", MATCH_LAST)) != NULL)
+			if ((key = locatestring(name, ".", MATCH_LAST)) != NULL)
 				key++;
-			else if ((key = locatestring(entry->name, "::", MATCH_LAST)) != NULL)
+			else if ((key = locatestring(name, "::", MATCH_LAST)) != NULL)
 				key += 2;
 			else
-				key = entry->name;
+				key = name;
 		}
-		/* Sort line number table */
-		qsort(lno_array, vb->length, sizeof(int), compare_lineno); 
+		/* Sort line number table unless they arrived in order */
+		if (!tags[t].sorted)
+			qsort(lno_array, lno_count, sizeof(int), compare_lineno);
 
 		strbuf_reset(gtop->sb);
 		strbuf_puts(gtop->sb, s_fid);
 		strbuf_putc(gtop->sb, ' ');
 		if (gtop->format & GTAGS_COMPNAME) {
-			strbuf_puts(gtop->sb, compress(entry->name, key));
+			strbuf_puts(gtop->sb, compress(name, key));
 		} else {
-			strbuf_puts(gtop->sb, entry->name);
+			strbuf_puts(gtop->sb, name);
 		}
 		strbuf_putc(gtop->sb, ' ');
 		header_offset = strbuf_getlen(gtop->sb);
@@ -1030,7 +1344,7 @@ flush_pool(GTOP *gtop, const char *s_fid)
 			int cont = 0;
 
 			last = 0;			/* line 0 doesn't exist */
-			for (i = 0; i < vb->length; i++) {
+			for (i = 0; i < lno_count; i++) {
 				int n = lno_array[i];
 
 				if (n == last)
@@ -1076,7 +1390,7 @@ flush_pool(GTOP *gtop, const char *s_fid)
 			 * This code is to support older format (version 4).
 			 */
 			last = 0;			/* line 0 doesn't exist */
-			for (i = 0; i < vb->length; i++) {
+			for (i = 0; i < lno_count; i++) {
 				int n = lno_array[i];
 
 				if (n == last)
@@ -1094,8 +1408,6 @@ flush_pool(GTOP *gtop, const char *s_fid)
 		if (strbuf_getlen(gtop->sb) > header_offset) {
 			dbop_put_tag(gtop->dbop, key, strbuf_value(gtop->sb));
 		}
-		/* Free line number table */
-		varray_close(vb);
 	}
 }
 /**
@@ -1127,41 +1439,47 @@ segment_read(GTOP *gtop)
 
 	/*
 	 * Save tag lines.
+	 * When every record of a segment is out of the scope,
+	 * read the next segment.
 	 */
-	gtop->cur_tagname[0] = '\0';
-	while ((tagline = dbop_next(gtop->dbop)) != NULL) {
-		VIRTUAL_GRTAGS_GSYMS_PROCESSING(gtop);
-		/*
-		 * get tag name and line number.
-		 *
-		 * tagline = <file id> <tag name> <line number>
-		 */
-		if (gtop->cur_tagname[0] == '\0') {
-			strlimcpy(gtop->cur_tagname, gtop->dbop->lastkey, sizeof(gtop->cur_tagname));
-		} else if (strcmp(gtop->cur_tagname, gtop->dbop->lastkey) != 0) {
+	do {
+		gtop->cur_tagname[0] = '\0';
+		while ((tagline = dbop_next(gtop->dbop)) != NULL) {
+			VIRTUAL_GRTAGS_GSYMS_PROCESSING(gtop);
 			/*
-			 * Dbop_next() wil read the same record again.
+			 * get tag name and line number.
+			 *
+			 * tagline = <file id> <tag name> <line number>
 			 */
-			dbop_unread(gtop->dbop);
-			break;
+			if (gtop->cur_tagname[0] == '\0') {
+				strlimcpy(gtop->cur_tagname, gtop->dbop->lastkey, sizeof(gtop->cur_tagname));
+			} else if (strcmp(gtop->cur_tagname, gtop->dbop->lastkey) != 0) {
+				/*
+				 * Dbop_next() wil read the same record again.
+				 */
+				dbop_unread(gtop->dbop);
+				break;
+			}
+			if (gtop->scope && !idset_contains(gtop->scope, atoi(tagline)))
+				continue;
+			gtp = varray_append(gtop->vb);
+			gtp->tagline = pool_strdup(gtop->segment_pool, tagline, 0);
+			gtp->tag = (const char *)gtop->cur_tagname;
+			/*
+			 * convert fid into hashed path name to save memory.
+			 */
+			fid = (const char *)strmake(tagline, " ");
+			path = gpath_fid2path(fid, NULL);
+			if (path == NULL)
+				die("gtags_first: path not found. (fid=%s)", fid);
+			sh = strhash_assign(gtop->path_hash, path, 1);
+			gtp->path = sh->name;
+			lineno = seekto(gtp->tagline, SEEKTO_LINENO);
+			if (lineno == NULL)
+				die("invalid tag record.\n%s", tagline);
+			gtp->lineno = atoi(lineno);
 		}
-		gtp = varray_append(gtop->vb);
-		gtp->tagline = pool_strdup(gtop->segment_pool, tagline, 0);
-		gtp->tag = (const char *)gtop->cur_tagname;
-		/*
-		 * convert fid into hashed path name to save memory.
-		 */
-		fid = (const char *)strmake(tagline, " ");
-		path = gpath_fid2path(fid, NULL);
-		if (path == NULL)
-			die("gtags_first: path not found. (fid=%s)", fid);
-		sh = strhash_assign(gtop->path_hash, path, 1);
-		gtp->path = sh->name;
-		lineno = seekto(gtp->tagline, SEEKTO_LINENO);
-		if (lineno == NULL)
-			die("invalid tag record.\n%s", tagline);
-		gtp->lineno = atoi(lineno);
-	}
+	} while (tagline != NULL && gtop->vb->length == 0);
 	/*
 	 * Sort tag lines.
 	 */
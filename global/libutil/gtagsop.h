@@ -87,6 +87,8 @@
 			/** don't sort */
 #define GTOP_NOSORT		128
 
+struct lno_pool;			/**< defined in gtagsop.c */
+
 /**
  * This entry corresponds to one raw record.
  */
@@ -134,6 +136,9 @@ typedef struct {
 	/** used for compact format and path name only read */
 	STRHASH *path_hash;
 
+	/** line numbers of the current file (compact format) */
+	struct lno_pool *lno_pool;
+
 	/*
 	 * Stuff for calling dbop
 	 */
@@ -142,6 +147,9 @@ typedef struct {
 	regex_t *preg;
 	int dbflags;
 	int readcount;
+
+	/** file ids in the scope (NULL: all files) */
+	IDSET *scope;
 } GTOP;
 
 const char *dbname(int);
@@ -149,9 +157,11 @@ GTOP *gtags_open(const char *, const char *, int, int, int);
 void gtags_put_using(GTOP *, const char *, int, const char *, const char *);
 void gtags_flush(GTOP *, const char *);
 void gtags_delete(GTOP *, IDSET *);
+void gtags_setscope(GTOP *, const char *, const char *);
 GTP *gtags_first(GTOP *, const char *, int);
 GTP *gtags_next(GTOP *);
 void gtags_show_statistics(GTOP *);
 void gtags_close(GTOP *);
+int decide_tag_by_context(const char *, const char *, const char *, int);
 
 #endif /* ! _GTOP_H_ */
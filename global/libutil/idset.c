@@ -41,10 +41,20 @@
  */
 #define IS_EMPTY(idset)	 ((idset)->min == END_OF_ID ? 1 : 0)
 
+/*
+ * The bitmap is divided into chunks of CHUNK_IDS ids, and a chunk is
+ * allocated when the first id in it is added. So, a set which has only
+ * a few ids of a large range takes little memory, and empty chunks are
+ * skipped at once by idset_next().
+ */
+#define CHUNK_IDS	4096
+#define CHUNK_WORDS	(CHUNK_IDS / LONG_BIT)
+#define NCHUNKS(size)	(((size) + CHUNK_IDS - 1) / CHUNK_IDS)
+
 /*
 Idset: usage and memory status
 
-				idset->set
+				idset->chunk[0]
 				[]
 
 idset = idset_open(21)		000000000000000000000___________
@@ -78,11 +88,23 @@ You should define index as an unsigned integer, and use END_OF_ID like follows:
 		-- processing about an id --
  */
 /**
- * bit mask table
- * Prepare all bit mask for performance.
+ * lowest_bit: return the index of the lowest set bit of a non-zero word.
  */
-static unsigned long *bit;
+static int
+lowest_bit(unsigned long word)
+{
+#if defined(__GNUC__) && (__GNUC__ > 3 || (__GNUC__ == 3 && __GNUC_MINOR__ >= 4))
+	return __builtin_ctzl(word);
+#else
+	int n = 0;
 
+	while (!(word & 1)) {
+		word >>= 1;
+		n++;
+	}
+	return n;
+#endif
+}
 /**
  * Allocate memory for new idset.
  */
@@ -90,15 +112,10 @@ IDSET *
 idset_open(unsigned int size)
 {
 	IDSET *idset = (IDSET *)check_malloc(sizeof(IDSET));
-	int i;
 
-	if (bit == NULL) {
-		bit = (unsigned long *)check_calloc(sizeof(unsigned long), LONG_BIT);
-		for (i = 0; i < LONG_BIT; i++)
-			bit[i] = 1UL << i;
-	}
-	idset->set = (unsigned long *)check_calloc(sizeof(unsigned long), (size + LONG_BIT - 1) / LONG_BIT);
+	idset->chunk = (unsigned long **)check_calloc(sizeof(unsigned long *), NCHUNKS(size) ? NCHUNKS(size) : 1);
 	idset->size = size;
+	idset->count = 0;
 	/*
 	 * Initialize all id expressions using invalid value.
 	 * END_OF_ID means 'no value' or 'out of range'.
@@ -127,10 +144,18 @@ void
 idset_add(IDSET *idset, unsigned int id)
 {
 	int empty = IS_EMPTY(idset);
+	unsigned long *chunk, mask;
 
 	if (id >= idset->size)
 		die("idset_add: id is out of range.");
-	idset->set[id / LONG_BIT] |= bit[id % LONG_BIT];
+	chunk = idset->chunk[id / CHUNK_IDS];
+	if (chunk == NULL)
+		chunk = idset->chunk[id / CHUNK_IDS] = (unsigned long *)check_calloc(sizeof(unsigned long), CHUNK_WORDS);
+	mask = 1UL << (id % LONG_BIT);
+	if (chunk[id % CHUNK_IDS / LONG_BIT] & mask)
+		return;
+	chunk[id % CHUNK_IDS / LONG_BIT] |= mask;
+	idset->count++;
 	if (empty)
 		idset->max = idset->min = id;
 	else if (id > idset->max)
@@ -148,11 +173,16 @@ idset_add(IDSET *idset, unsigned int id)
 int
 idset_contains(IDSET *idset, unsigned int id)
 {
+	unsigned long *chunk;
+
 	if (IS_EMPTY(idset))
 		return 0;
 	if (id < idset->min || id > idset->max)
 		return 0;
-	return (idset->set[id / LONG_BIT] & bit[id % LONG_BIT]) != 0;
+	chunk = idset->chunk[id / CHUNK_IDS];
+	if (chunk == NULL)
+		return 0;
+	return (chunk[id % CHUNK_IDS / LONG_BIT] >> (id % LONG_BIT)) & 1;
 }
 /**
  * Get first id.
@@ -174,33 +204,42 @@ idset_first(IDSET *idset)
  *      @param[in]      idset   idset structure
  *      @return              id (END_OF_ID: end of id)
  *
+ * Whole words and chunks without ids are skipped.
  */
 unsigned int
 idset_next(IDSET *idset)
 {
-	unsigned int i, limit;
-	int index0, index1;
+	unsigned int id, c, w, limit;
+	unsigned long *chunk, word;
 
 	if (IS_EMPTY(idset))
 		return END_OF_ID;
 	if (idset->lastid >= idset->max)
 		return END_OF_ID;
-	limit = idset->max / LONG_BIT + 1;
-	index0 = idset->lastid / LONG_BIT;
-	index1 = idset->lastid % LONG_BIT;
-	for (i = ++index1; i < LONG_BIT; i++)
-		if (bit[i] & idset->set[index0])
-			return idset->lastid = index0 * LONG_BIT + i;
-	index0++;
-	for (i = index0; i < limit && idset->set[i] == 0; i++)
-		;
-	if (i >= limit)
-		die("idset_next: internal error.");
-	index0 = i;
-	for (i = 0; i < LONG_BIT; i++)
-		if (bit[i] & idset->set[index0])
-			return idset->lastid = index0 * LONG_BIT + i;
-	die("idset_next: internal error.");
+	id = idset->lastid + 1;
+	limit = idset->max / CHUNK_IDS;
+	c = id / CHUNK_IDS;
+	w = id % CHUNK_IDS / LONG_BIT;
+	/* the rest of the current word */
+	word = 0;
+	chunk = idset->chunk[c];
+	if (chunk)
+		word = chunk[w] & (~0UL << (id % LONG_BIT));
+	for (;;) {
+		if (word)
+			return idset->lastid = c * CHUNK_IDS + w * LONG_BIT + lowest_bit(word);
+		if (chunk && ++w < CHUNK_WORDS) {
+			word = chunk[w];
+			continue;
+		}
+		/* next chunk which has ids */
+		do {
+			if (++c > limit)
+				die("idset_next: internal error.");
+		} while ((chunk = idset->chunk[c]) == NULL);
+		w = 0;
+		word = chunk[0];
+	}
 }
 /**
  * Return the number of bits.
@@ -211,11 +250,7 @@ idset_next(IDSET *idset)
 unsigned int
 idset_count(IDSET *idset)
 {
-	unsigned int id, count = 0;
-
-	for (id = idset_first(idset); id != END_OF_ID; id = idset_next(idset))
-		count++;
-	return count;
+	return idset->count;
 }
 /**
  * Free memory for the idset.
@@ -223,6 +258,11 @@ idset_count(IDSET *idset)
 void
 idset_close(IDSET *idset)
 {
-	free(idset->set);
+	unsigned int i;
+
+	for (i = 0; i < NCHUNKS(idset->size); i++)
+		if (idset->chunk[i])
+			free(idset->chunk[i]);
+	free(idset->chunk);
 	free(idset);
 }
@@ -29,7 +29,8 @@ typedef struct {
 	unsigned int min;
 	unsigned int max;
 	unsigned int lastid;		/**< used by idset_first() and idset_next() */
-	unsigned long *set;
+	unsigned int count;		/**< number of ids */
+	unsigned long **chunk;		/**< bitmap chunks (NULL: no id in it) */
 } IDSET;
 
 IDSET *idset_open(unsigned int);
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2026 Tama Communications Corporation
+ *
+ * This file is part of GNU GLOBAL.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdlib.h>
+#ifdef HAVE_STRING_H
+#include <string.h>
+#else
+#include <strings.h>
+#endif
+
+#include "checkalloc.h"
+#include "getdbpath.h"
+#include "gparam.h"
+#include "gtagsop.h"
+#include "libpath.h"
+#include "locatestring.h"
+#include "makepath.h"
+#include "path.h"
+#include "strbuf.h"
+#include "test.h"
+
+/*
+ * ensure GTAGSLIBPATH compares correctly
+ */
+#if defined(_WIN32) || defined(__DJGPP__)
+#define STRCMP stricmp
+#define back2slash(sb) do {		\
+	char *p = strbuf_value(sb);	\
+	for (; *p; p++) 		\
+		if (*p == '\\')         \
+			*p = '/';       \
+} while (0)
+#else
+#define STRCMP strcmp
+#define back2slash(sb)
+#endif
+
+/**
+ * libpath_open: pick up the library trees in GTAGSLIBPATH.
+ *
+ *	@param[in]	dbpath	database directory of the current tree
+ *	@param[in]	db	GTAGS,GRTAGS,GSYMS
+ *	@return		array of LIBTREE in library order
+ *
+ * Trees which don't have the tag file of db and the current tree itself
+ * are skipped. If GTAGSLIBPATH is not set, the array is empty.
+ */
+VARRAY *
+libpath_open(const char *dbpath, int db)
+{
+	VARRAY *vb = varray_open(sizeof(LIBTREE), 16);
+	STRBUF *sb;
+	LIBTREE *t;
+	char *libdir, *nextp = NULL;
+	char libdbpath[MAXPATHLEN];
+
+	if (getenv("GTAGSLIBPATH") == NULL)
+		return vb;
+	sb = strbuf_open(0);
+	strbuf_puts(sb, getenv("GTAGSLIBPATH"));
+	back2slash(sb);
+	for (libdir = strbuf_value(sb); libdir; libdir = nextp) {
+		if ((nextp = locatestring(libdir, PATHSEP, MATCH_FIRST)) != NULL)
+			*nextp++ = 0;
+		if (!gtagsexist(libdir, libdbpath, sizeof(libdbpath), 0))
+			continue;
+		if (!STRCMP(dbpath, libdbpath))
+			continue;
+		if (!test("f", makepath(libdbpath, dbname(db), NULL)))
+			continue;
+		t = varray_append(vb);
+		t->dir = check_strdup(libdir);
+		t->dbpath = check_strdup(libdbpath);
+	}
+	strbuf_close(sb);
+	return vb;
+}
+/**
+ * libpath_close: free the array made by libpath_open().
+ *
+ *	@param[in]	vb	array of LIBTREE
+ */
+void
+libpath_close(VARRAY *vb)
+{
+	LIBTREE *trees = varray_assign(vb, 0, 0);
+	int i;
+
+	for (i = 0; i < vb->length; i++) {
+		free(trees[i].dir);
+		free(trees[i].dbpath);
+	}
+	varray_close(vb);
+}
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2026 Tama Communications Corporation
+ *
+ * This file is part of GNU GLOBAL.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _LIBPATH_H_
+#define _LIBPATH_H_
+
+#include "varray.h"
+
+/**
+ * Library tree in GTAGSLIBPATH.
+ */
+typedef struct {
+	char *dir;			/**< root of the tree */
+	char *dbpath;			/**< database directory */
+} LIBTREE;
+
+VARRAY *libpath_open(const char *, int);
+void libpath_close(VARRAY *);
+
+#endif /* ! _LIBPATH_H_ */
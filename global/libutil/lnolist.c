@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2026 Tama Communications Corporation
+ *
+ * This file is part of GNU GLOBAL.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <ctype.h>
+
+#include "lnolist.h"
+
+/*
+ * If GTAGS_COMPLINE is set, each line number is expressed as the
+ * difference from the previous one except for the head, and successive
+ * line numbers are expressed as a range.
+ *	ex: 10,3,2 means '10 13 15'.
+ *	ex: 10-3 means '10 11 12 13'.
+ * Please see flush_pool() in libutil/gtagsop.c for the details.
+ */
+/**
+ * lnolist_open: setup the line number list.
+ *
+ *	@param[out]	l	line number list
+ *	@param[in]	list	line number part of a tag record
+ *	@param[in]	compline	1: GTAGS_COMPLINE is set
+ */
+void
+lnolist_open(LNOLIST *l, const char *list, int compline)
+{
+	l->p = list;
+	l->compline = compline;
+	l->last = l->cont = 0;
+}
+/**
+ * lnolist_next: get the next line number.
+ *
+ *	@param[in]	l	line number list
+ *	@return		line number, 0: end of list
+ */
+int
+lnolist_next(LNOLIST *l)
+{
+	int n;
+
+	if (l->cont > 0) {
+		if (l->last < l->cont)
+			return ++l->last;
+		l->cont = 0;
+	}
+	if (*l->p == ',')
+		l->p++;
+	if (!isdigit((unsigned char)*l->p))
+		return 0;
+	for (n = 0; isdigit((unsigned char)*l->p); l->p++)
+		n = n * 10 + (*l->p - '0');
+	if (l->compline) {
+		n += l->last;
+		if (*l->p == '-') {
+			for (l->p++, l->cont = 0; isdigit((unsigned char)*l->p); l->p++)
+				l->cont = l->cont * 10 + (*l->p - '0');
+			l->cont += n;
+		}
+	}
+	return l->last = n;
+}
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2026 Tama Communications Corporation
+ *
+ * This file is part of GNU GLOBAL.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _LNOLIST_H_
+#define _LNOLIST_H_
+
+/**
+ * Line number list of the compact format: <line number>,<line number>,...
+ */
+typedef struct {
+	const char *p;			/**< current position */
+	int compline;			/**< GTAGS_COMPLINE is set */
+	int last;			/**< last line number */
+	int cont;			/**< end of the current range */
+} LNOLIST;
+
+void lnolist_open(LNOLIST *, const char *, int);
+int lnolist_next(LNOLIST *);
+
+#endif /* ! _LNOLIST_H_ */
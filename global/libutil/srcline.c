@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2026 Tama Communications Corporation
+ *
+ * This file is part of GNU GLOBAL.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <ctype.h>
+#include <stdio.h>
+#ifdef STDC_HEADERS
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#else
+#include <strings.h>
+#endif
+
+#include "checkalloc.h"
+#include "die.h"
+#include "makepath.h"
+#include "srcline.h"
+#include "strlimcpy.h"
+
+/**
+ * srcline_open: open line reader.
+ *
+ *	@param[in]	root	root directory of path names
+ *	@param[in]	flags	SRCLINE_WARNING: warn if a file is not available
+ *	@return		line reader
+ */
+SRCLINE *
+srcline_open(const char *root, int flags)
+{
+	SRCLINE *sl = (SRCLINE *)check_calloc(sizeof(SRCLINE), 1);
+
+	strlimcpy(sl->root, root, sizeof(sl->root));
+	sl->ib = strbuf_open(0);
+	sl->flags = flags;
+	return sl;
+}
+/**
+ * srcline_get: read a line from the source file.
+ *
+ *	@param[in]	sl	line reader
+ *	@param[in]	path	path name (relative to the root)
+ *	@param[in]	lineno	line number
+ *	@return		line image ("" if not available)
+ *
+ * The lines of a file are usually requested in ascending order, so the
+ * file is kept open and read forward. It is rewound only when a previous
+ * line is requested.
+ */
+const char *
+srcline_get(SRCLINE *sl, const char *path, int lineno)
+{
+	if (strcmp(path, sl->path) != 0) {
+		if (sl->fp)
+			fclose(sl->fp);
+		strlimcpy(sl->path, path, sizeof(sl->path));
+		sl->fp = fopen(makepath(sl->root, path, NULL), "r");
+		if (sl->fp == NULL && (sl->flags & SRCLINE_WARNING))
+			warning("source file '%s' is not available.", path);
+		sl->lineno = 0;
+		strbuf_clear(sl->ib);
+	} else if (lineno < sl->lineno && sl->fp) {
+		rewind(sl->fp);
+		sl->lineno = 0;
+	}
+	if (lineno == sl->lineno)
+		return strbuf_value(sl->ib);
+	strbuf_clear(sl->ib);
+	while (sl->fp && sl->lineno < lineno) {
+		if (strbuf_fgets(sl->ib, sl->fp, STRBUF_NOCRLF) == NULL) {
+			fclose(sl->fp);
+			sl->fp = NULL;
+			sl->lineno = 0;
+			strbuf_clear(sl->ib);
+			break;
+		}
+		sl->lineno++;
+	}
+	return strbuf_value(sl->ib);
+}
+/**
+ * srcline_close: close line reader.
+ *
+ *	@param[in]	sl	line reader
+ */
+void
+srcline_close(SRCLINE *sl)
+{
+	if (sl->fp)
+		fclose(sl->fp);
+	strbuf_close(sl->ib);
+	free(sl);
+}
+/**
+ * srcline_column: column of the tag in the line image
+ *
+ *	@param[in]	image	line image
+ *	@param[in]	tag	tag name
+ *	@return		column, or the length of the line if not found
+ *
+ * Tags in a line are sorted by this column to follow the order of the
+ * parser, because the tag files keep no column.
+ */
+int
+srcline_column(const char *image, const char *tag)
+{
+	int len = strlen(tag);
+	const char *p;
+
+#define IDCHAR(c)	(isalnum((unsigned char)(c)) || (c) == '_')
+	for (p = image; (p = strstr(p, tag)) != NULL; p++)
+		if ((p == image || !IDCHAR(p[-1])) && !IDCHAR(p[len]))
+			return p - image;
+#undef IDCHAR
+	return strlen(image);
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2026 Tama Communications Corporation
+ *
+ * This file is part of GNU GLOBAL.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _SRCLINE_H_
+#define _SRCLINE_H_
+
+#include <stdio.h>
+#include "gparam.h"
+#include "strbuf.h"
+
+/** warn if a source file is not available */
+#define SRCLINE_WARNING	1
+
+/**
+ * Line reader for the tag files which don't have line images.
+ */
+typedef struct {
+	char root[MAXPATHLEN];		/**< root directory of path names */
+	char path[MAXPATHLEN];		/**< current path */
+	FILE *fp;			/**< file pointer of the current path */
+	int lineno;			/**< line number of the current line */
+	STRBUF *ib;			/**< current line */
+	int flags;
+} SRCLINE;
+
+SRCLINE *srcline_open(const char *, int);
+const char *srcline_get(SRCLINE *, const char *, int);
+void srcline_close(SRCLINE *);
+int srcline_column(const char *, const char *);
+
+#endif /* ! _SRCLINE_H_ */
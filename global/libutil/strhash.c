@@ -70,6 +70,21 @@ strhash_close(hash);				// free resources.
 						entry
 */
 
+/*
+ * The table uses open addressing with linear probing. Each slot points
+ * to an entry allocated in the pool, so an entry never moves even when
+ * the table grows, and the hash value stored in the entry is compared
+ * before the name. The table is doubled when it becomes half full.
+ *
+ * The order of iteration is the same as that of the former chained
+ * table with 'buckets' buckets: by bucket (hash % buckets), and the
+ * latest entry first in a bucket. It is made by a counting sort in
+ * strhash_first(), so the output which depends on it does not change.
+ */
+#define MIN_SLOTS	16
+/** slot index from the hash value (Fibonacci hashing) */
+#define SLOT(sh, h)	(((((h) & 0xffffffffUL) * 2654435769UL) & 0xffffffffUL) >> (32 - (sh)->bits))
+
 #define obstack_chunk_alloc check_malloc
 #define obstack_chunk_free free
 
@@ -83,16 +98,41 @@ STRHASH *
 strhash_open(int buckets)
 {
 	STRHASH *sh = (STRHASH *)check_calloc(sizeof(STRHASH), 1);
-	int i;
 
-	sh->htab = (struct sh_head *)check_calloc(sizeof(struct sh_head), buckets);
-	for (i = 0; i < buckets; i++)
-		SLIST_INIT(&sh->htab[i]);
+	if (buckets <= 0)
+		die("strhash_open: invalid bucket size.");
 	sh->buckets = buckets;
+	sh->size = MIN_SLOTS;
+	sh->bits = 4;
+	while (sh->size < (unsigned long)buckets && sh->bits < 30) {
+		sh->size *= 2;
+		sh->bits++;
+	}
+	sh->slots = (struct sh_entry **)check_calloc(sizeof(struct sh_entry *), sh->size);
 	sh->pool = pool_open();
+	sh->list = varray_open(sizeof(struct sh_entry *), 100);
 	sh->entries = 0;
 	return sh;
 }
+/**
+ * expand: double the table.
+ */
+static void
+expand(STRHASH *sh)
+{
+	struct sh_entry **list = varray_assign(sh->list, 0, 0);
+	unsigned long i, j;
+
+	free(sh->slots);
+	sh->size *= 2;
+	sh->bits++;
+	sh->slots = (struct sh_entry **)check_calloc(sizeof(struct sh_entry *), sh->size);
+	for (i = 0; i < sh->entries; i++) {
+		for (j = SLOT(sh, list[i]->hash); sh->slots[j] != NULL; j = (j + 1) & (sh->size - 1))
+			;
+		sh->slots[j] = list[i];
+	}
+}
 /**
  * strhash_assign: assign hash entry.
  *
@@ -108,24 +148,29 @@ strhash_open(int buckets)
 struct sh_entry *
 strhash_assign(STRHASH *sh, const char *name, int force)
 {
-	struct sh_head *head = &sh->htab[__hash_string(name) % sh->buckets];
+	unsigned long hash = __hash_string(name);
+	unsigned long i;
 	struct sh_entry *entry;
 
 	/*
 	 * Lookup the name's entry.
 	 */
-	SLIST_FOREACH(entry, head, ptr)
-		if (strcmp(entry->name, name) == 0)
-			break;
+	for (i = SLOT(sh, hash); (entry = sh->slots[i]) != NULL; i = (i + 1) & (sh->size - 1))
+		if (entry->hash == hash && strcmp(entry->name, name) == 0)
+			return entry;
 	/*
 	 * If not found, allocate an entry.
 	 */
-	if (entry == NULL && force) {
+	if (force) {
 		entry = pool_malloc(sh->pool, sizeof(struct sh_entry));
 		entry->name = pool_strdup(sh->pool, name, 0);
 		entry->value = NULL;
-		SLIST_INSERT_HEAD(head, entry, ptr);
+		entry->hash = hash;
+		sh->slots[i] = entry;
+		*(struct sh_entry **)varray_append(sh->list) = entry;
 		sh->entries++;
+		if (sh->entries * 2 > sh->size)
+			expand(sh);
 	}
 	return entry;
 }
@@ -151,8 +196,28 @@ strhash_strdup(STRHASH *sh, const char *string, int size)
 struct sh_entry *
 strhash_first(STRHASH *sh)
 {
-	sh->cur_bucket = -1;		/* to start from index 0. */
-	sh->cur_entry = NULL;
+	struct sh_entry **list;
+	unsigned long *start, i;
+
+	/*
+	 * Arrange the entries in the order of iteration.
+	 */
+	if (sh->iter)
+		free(sh->iter);
+	sh->iter = NULL;
+	sh->cur = 0;
+	if (sh->entries == 0)
+		return NULL;
+	sh->iter = (struct sh_entry **)check_malloc(sizeof(struct sh_entry *) * sh->entries);
+	start = (unsigned long *)check_calloc(sizeof(unsigned long), sh->buckets + 1);
+	list = varray_assign(sh->list, 0, 0);
+	for (i = 0; i < sh->entries; i++)
+		start[list[i]->hash % sh->buckets + 1]++;
+	for (i = 0; i < (unsigned long)sh->buckets; i++)
+		start[i + 1] += start[i];
+	for (i = sh->entries; i > 0; i--)
+		sh->iter[start[list[i - 1]->hash % sh->buckets]++] = list[i - 1];
+	free(start);
 	return strhash_next(sh);
 }
 /**
@@ -163,20 +228,9 @@ strhash_first(STRHASH *sh)
 struct sh_entry *
 strhash_next(STRHASH *sh)
 {
-	struct sh_entry *entry = NULL;
-
-	if (sh->buckets > 0 && sh->cur_bucket < sh->buckets) {
-		entry = sh->cur_entry;
-		if (entry == NULL) {
-			while (++sh->cur_bucket < sh->buckets) {
-				entry = SLIST_FIRST(&sh->htab[sh->cur_bucket]);
-				if (entry)
-					break;
-			}
-		}
-		sh->cur_entry = (entry) ? SLIST_NEXT(entry, ptr) : NULL;
-	}
-	return entry;
+	if (sh->iter == NULL || sh->cur >= sh->entries)
+		return NULL;
+	return sh->iter[sh->cur++];
 }
 /**
  * strhash_reset: reset string hash.
@@ -186,13 +240,14 @@ strhash_next(STRHASH *sh)
 void
 strhash_reset(STRHASH *sh)
 {
-	int i;
-
 	/*
-	 * Free and reinitialize entries for each bucket.
+	 * Empty the table keeping its size.
 	 */
-	for (i = 0; i < sh->buckets; i++) {
-		SLIST_INIT(&sh->htab[i]);
+	memset(sh->slots, 0, sizeof(struct sh_entry *) * sh->size);
+	varray_reset(sh->list);
+	if (sh->iter) {
+		free(sh->iter);
+		sh->iter = NULL;
 	}
 	/*
 	 * Free all memory in sh->pool but leave it valid for further allocation.
@@ -209,6 +264,9 @@ void
 strhash_close(STRHASH *sh)
 {
 	pool_close(sh->pool);
-	free(sh->htab);
+	varray_close(sh->list);
+	if (sh->iter)
+		free(sh->iter);
+	free(sh->slots);
 	free(sh);
 }
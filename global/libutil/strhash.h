@@ -20,26 +20,27 @@
 #define _STRHASH_H
 
 #include "pool.h"
-#include "queue.h"
+#include "varray.h"
 
 struct sh_entry {
-	SLIST_ENTRY(sh_entry) ptr;
 	char *name;			/**< name:  hash key		*/
 	void *value;			/**< value: user structure	*/
+	unsigned long hash;		/**< hash value of the name	*/
 };
 
-SLIST_HEAD(sh_head, sh_entry);
-
 typedef struct {
-	int buckets;			/**< number of buckets		*/
-	struct sh_head *htab;		/**< hash buckets			*/
+	int buckets;			/**< number of buckets (decides the order of iteration) */
+	struct sh_entry **slots;	/**< open addressing table	*/
+	unsigned long size;		/**< number of slots (power of 2) */
+	int bits;			/**< log2(size)			*/
 	POOL *pool;			/**< memory pool			*/
 	unsigned long entries;		/**< number of entries		*/
+	VARRAY *list;			/**< entries in the order of addition */
 	/**
 	 * iterator
 	 */
-	struct sh_entry *cur_entry;
-	int cur_bucket;
+	struct sh_entry **iter;		/**< entries in the order of iteration */
+	unsigned long cur;
 } STRHASH;
 
 STRHASH *strhash_open(int);
@@ -23,6 +23,7 @@
 #endif
 #include <assert.h>
 #include <ctype.h>
+#include <stdio.h>
 #ifdef STDC_HEADERS
 #include <stdlib.h>
 #endif
@@ -146,3 +147,22 @@ check_version(const char *target_version, const char *required_version)
 	else
 		return 0;
 }
+/**
+ * read the first line of command's output
+ *
+ *	@param[in]	com	command line
+ *	@param[in]	sb	string buffer
+ *	@return			0: normal, -1: error
+ */
+int
+read_first_line(const char *com, STRBUF *sb)
+{
+	FILE *ip = popen(com, "r");
+	char *p;
+
+	if (ip == NULL)
+		return -1;
+	p = strbuf_fgets(sb, ip, STRBUF_NOCRLF);
+	pclose(ip);
+	return (p == NULL) ? -1 : 0;
+}
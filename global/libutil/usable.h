@@ -21,7 +21,10 @@
 #ifndef _USABLE_H_
 #define _USABLE_H_
 
+#include "strbuf.h"
+
 char *usable(const char *);
 int check_version(const char *, const char *);
+int read_first_line(const char *, STRBUF *);
 
 #endif /* ! _USABLE_H_ */
@@ -42,6 +42,7 @@
 #include "checkalloc.h"
 #include "conf.h"
 #include "strbuf.h"
+#include "tag-batch.h"
 
 /*
  * Function layer plugin parser sample
@@ -99,7 +100,7 @@ copy_langmap_converting_cpp(char *dst, const char *src)
 static HANDLE pid;
 static char argv[] = "\" "
 #if defined(USE_EXTRA_FIELDS)
-	"\"--_xformat=%R %-16N %4n %-16F %C\" "
+	"\"--_xformat=%R\t%N\t%n\t%C\" "
 	"--extra=+r "
 	"--fields=+r "
 #else
@@ -179,7 +180,7 @@ static char *argv[] = {
 	"ctags",
 	NULL,
 #if defined(USE_EXTRA_FIELDS)
-	"--_xformat=%R %-16N %4n %-16F %C",
+	"--_xformat=%R\t%N\t%n\t%C",
 	"--extra=+r",
 	"--fields=+r",
 #else
@@ -279,21 +280,21 @@ get_line(const struct parser_param *param)
 	return linebuf;
 }
 
+#if defined(USE_EXTRA_FIELDS)
 static void
 put_line(char *ctags_x, const struct parser_param *param)
 {
 	int lineno;
 	int type = PARSER_DEF;
-	char *p, *tagname, *filename;
+	char *tagname, *p;
 
-#if defined(USE_EXTRA_FIELDS)
 	/*
 	 * Output of ctags:
-	 * ctags -x ...
-	 * main              326 global/global.c  main(int argc, char **argv)
+	 * ctags -x --_xformat="%R\t%N\t%n\t%C" --extra=+r --fields=+r
+	 * D<TAB>main<TAB>326<TAB>main(int argc, char **argv)
 	 *
-	 * ctags -x --_xformat="%R %-16N %4n %-16F %C" --extra=+r --fields=+r
-	 * D main              326 global/global.c  main(int argc, char **argv)
+	 * The fields are separated by tabs, and the line image is the rest
+	 * of the line. So, they are picked up in one forward pass.
 	 */
 	switch (*ctags_x) {
 	case 'D':
@@ -305,12 +306,33 @@ put_line(char *ctags_x, const struct parser_param *param)
 	default:
 		param->die("unexpected type string.");
 	}
-	/* skip type string */
-	while (*ctags_x && !isspace((unsigned char)*ctags_x))
-		ctags_x++;
-	while (*ctags_x  && isspace((unsigned char)*ctags_x))
-		ctags_x++;
-#endif
+	p = ctags_x + 1;
+	if (*p++ != '\t')
+		return;
+	tagname = p;
+	while (*p && *p != '\t')
+		p++;
+	if (*p != '\t' || p == tagname)
+		return;
+	*p++ = '\0';
+	if (!isdigit((unsigned char)*p))
+		return;
+	for (lineno = 0; isdigit((unsigned char)*p); p++)
+		lineno = lineno * 10 + (*p - '0');
+	if (*p == '\t')
+		p++;
+	else if (*p != '\0')
+		return;
+	add_tag(type, tagname, strlen(tagname), lineno, p, strlen(p), param);
+}
+#else
+static void
+put_line(char *ctags_x, const struct parser_param *param)
+{
+	int lineno;
+	int type = PARSER_DEF;
+	char *p, *tagname, *filename;
+
 	filename = strstr(ctags_x, param->file);
 	if (filename == NULL || filename == ctags_x)
 		return;
@@ -345,15 +367,16 @@ put_line(char *ctags_x, const struct parser_param *param)
 		while (isspace((unsigned char)*p))
 			p++;
 	}
-	param->put(type, tagname, lineno, filename, p, param->arg);
+	add_tag(type, tagname, strlen(tagname), lineno, p, strlen(p), param);
 }
+#endif
 
 void
 parser(const struct parser_param *param)
 {
 	char *ctags_x;
 
-	assert(param->size >= sizeof(*param));
+	assert(param->size >= offsetof(struct parser_param, put_batch));
 
 	if (op == NULL)
 		start_ctags(param);
@@ -372,4 +395,5 @@ parser(const struct parser_param *param)
 			break;
 		put_line(ctags_x, param);
 	}
+	flush_tags(param);
 }
@@ -26,7 +26,6 @@
 #endif
 #include <sys/types.h>
 #include <assert.h>
-#include <ctype.h>
 #include <errno.h>
 #include <stdio.h>
 #ifdef STDC_HEADERS
@@ -42,6 +41,7 @@
 #endif
 
 #include "parser.h"
+#include "tag-batch.h"
 
 #if defined(_WIN32) && !defined(__CYGWIN__)
 #define PYTHON		"python"
@@ -54,12 +54,11 @@
  * Function layer plugin parser sample
  */
 
-#define TERMINATOR		"###terminator###"
 #define LANGMAP_OPTION		"--langmap="
 #define INITIAL_BUFSIZE		1024
 
 static FILE *ip, *op;
-static char *linebuf;
+static unsigned char *framebuf;	/**< records of a frame */
 static size_t bufsize;
 
 #ifdef __GNUC__
@@ -132,20 +131,20 @@ start_process(const struct parser_param *param)
 	CloseHandle(pi.hThread);
 	pid = pi.hProcess;
 	op = fdopen(_open_osfhandle((long)opipe[1], _O_WRONLY), "w");
-	ip = fdopen(_open_osfhandle((long)ipipe[0], _O_RDONLY), "r");
+	ip = fdopen(_open_osfhandle((long)ipipe[0], _O_RDONLY | _O_BINARY), "rb");
 	if (ip == NULL || op == NULL)
 		param->die("fdopen failed.");
 
 	bufsize = INITIAL_BUFSIZE;
-	linebuf = malloc(bufsize);
-	if (linebuf == NULL)
+	framebuf = malloc(bufsize);
+	if (framebuf == NULL)
 		param->die("short of memory.");
 }
 static void
 terminate_process(void) {
 	if (op == NULL)
 		return;
-	free(linebuf);
+	free(framebuf);
 	fclose(op);
 	fclose(ip);
 	WaitForSingleObject(pid, INFINITE);
@@ -192,14 +191,14 @@ start_process(const struct parser_param *param)
 	free(argv[1]);
 	close(opipe[0]);
 	close(ipipe[1]);
-	ip = fdopen(ipipe[0], "r");
+	ip = fdopen(ipipe[0], "rb");
 	op = fdopen(opipe[1], "w");
 	if (ip == NULL || op == NULL)
 		param->die("fdopen failed.");
 
 	bufsize = INITIAL_BUFSIZE;
-	linebuf = malloc(bufsize);
-	if (linebuf == NULL)
+	framebuf = malloc(bufsize);
+	if (framebuf == NULL)
 		param->die("short of memory.");
 }
 
@@ -208,7 +207,7 @@ terminate_process(void)
 {
 	if (op == NULL)
 		return;
-	free(linebuf);
+	free(framebuf);
 	fclose(op);
 	fclose(ip);
 	while (waitpid(pid, NULL, 0) < 0 && errno == EINTR)
@@ -216,105 +215,102 @@ terminate_process(void)
 }
 #endif
 
-static char *
-get_line(const struct parser_param *param)
+/*
+ * Output of pygments_parser.py:
+ *
+ * The tags of a file are sent as a frame, which is the length of the
+ * records followed by the records. A record is
+ *
+ * <type> <line number> <length of tag> <tag> <length of image> <image>
+ *
+ * <type> is a byte 'D' (definition) or 'R' (reference), and the other
+ * numbers are 32-bit unsigned integers in network byte order. The
+ * strings are not terminated by '\0', and may include any character.
+ * So, neither the tag nor the line image is ever scanned for delimiters.
+ */
+#define RECORD_HEADER_SIZE	(1 + 4 + 4)
+
+static unsigned long
+get_uint32(const unsigned char *p)
 {
-	size_t linelen = 0;
+	return ((unsigned long)p[0] << 24) | ((unsigned long)p[1] << 16)
+		| ((unsigned long)p[2] << 8) | (unsigned long)p[3];
+}
+/**
+ * read_frame: read a frame from the process.
+ *
+ *	@param[in]	param	parser parameter
+ *	@return		length of the records in framebuf
+ */
+static size_t
+read_frame(const struct parser_param *param)
+{
+	unsigned char header[4];
+	size_t length;
 
-	for (;;) {
-		if (fgets(linebuf + linelen, bufsize - linelen, ip) == NULL) {
-			if (linelen == 0)
-				return NULL;
-			break;
-		}
-		linelen += strlen(linebuf + linelen);
-		if (linelen < bufsize - 1 || linebuf[linelen - 1] == '\n'
-		 || feof(ip))
-			break;
-		bufsize *= 2;
-		linebuf = realloc(linebuf, bufsize);
-		if (linebuf == NULL)
+	if (fread(header, 1, sizeof(header), ip) != sizeof(header))
+		param->die("unexpected EOF.");
+	length = get_uint32(header);
+	if (length > bufsize) {
+		while (length > bufsize)
+			bufsize *= 2;
+		framebuf = realloc(framebuf, bufsize);
+		if (framebuf == NULL)
 			param->die("short of memory.");
 	}
-	while (linelen-- > 0
-		&& (linebuf[linelen] == '\n' || linebuf[linelen] == '\r'))
-		linebuf[linelen] = '\0';
-	return linebuf;
+	if (fread(framebuf, 1, length, ip) != length)
+		param->die("unexpected EOF.");
+	return length;
 }
-
+/**
+ * put_frame: store the records of a frame.
+ *
+ *	@param[in]	length	length of the records in framebuf
+ *	@param[in]	param	parser parameter
+ */
 static void
-put_line(char *line, const struct parser_param *param)
+put_frame(size_t length, const struct parser_param *param)
 {
-	int lineno;
-	int type = PARSER_DEF;
-	char *p, *tagname, *filename;
+	const unsigned char *p = framebuf, *end = framebuf + length;
+	const unsigned char *tag, *image;
+	unsigned long taglen, imagelen;
+	int type = PARSER_DEF, lineno;
 
-	/*
-	 * Output of ctags:
-	 * ctags -x ...
-	 * main              326 global/global.c  main(int argc, char **argv)
-	 *
-	 * ctags -x --gtags ...
-	 * D main              326 global/global.c  main(int argc, char **argv)
-	 */
-	switch (*line) {
-	case 'D':
-		type = PARSER_DEF;
-		break;
-	case 'R':
-		type = PARSER_REF_SYM;
-		break;
-	default:
-		param->die("unexpected type string: %s", line);
-	}
-	/* skip type string */
-	while (*line && !isspace((unsigned char)*line))
-		line++;
-	while (*line  && isspace((unsigned char)*line))
-		line++;
-	filename = strstr(line, param->file);
-	if (filename == NULL || filename == line)
-		return;
-	p = filename - 1;
-	if (!isspace((unsigned char)*p))
-		return;
-	while (p >= line && isspace((unsigned char)*p))
-		*p-- = '\0';
-	if (p < line)
-		return;
-	if (!isdigit((unsigned char)*p))
-		return;
-	while (p >= line && isdigit((unsigned char)*p))
-		p--;
-	if (p < line)
-		return;
-	lineno = atoi(p + 1);
-	if (!isspace((unsigned char)*p))
-		return;
-	while (p >= line && isspace((unsigned char)*p))
-		*p-- = '\0';
-	if (p < line)
-		return;
-	while (p >= line && !isspace((unsigned char)*p))
-		p--;
-	tagname = p + 1;
-	p = filename + strlen(param->file);
-	if (*p != '\0') {
-		if (!isspace((unsigned char)*p))
-			return;
-		*p++ = '\0';
-		while (isspace((unsigned char)*p))
-			p++;
+	while (p < end) {
+		if (end - p < RECORD_HEADER_SIZE)
+			param->die("broken frame.");
+		switch (*p) {
+		case 'D':
+			type = PARSER_DEF;
+			break;
+		case 'R':
+			type = PARSER_REF_SYM;
+			break;
+		default:
+			param->die("unexpected type: %d", *p);
+		}
+		lineno = get_uint32(p + 1);
+		taglen = get_uint32(p + 5);
+		p += RECORD_HEADER_SIZE;
+		if ((unsigned long)(end - p) < taglen + 4)
+			param->die("broken frame.");
+		tag = p;
+		p += taglen;
+		imagelen = get_uint32(p);
+		p += 4;
+		if ((unsigned long)(end - p) < imagelen)
+			param->die("broken frame.");
+		image = p;
+		p += imagelen;
+		if (taglen > 0 && lineno > 0)
+			add_tag(type, (const char *)tag, taglen, lineno, (const char *)image, imagelen, param);
 	}
-	param->put(type, tagname, lineno, filename, p, param->arg);
 }
 
 void
 parser(const struct parser_param *param)
 {
-	char *line;
-
-	assert(param->size >= sizeof(*param));
+	assert(param->size >= offsetof(struct parser_param, put_batch));
 
 	if (op == NULL)
 		start_process(param);
@@ -325,12 +321,6 @@ parser(const struct parser_param *param)
 	fflush(op);
 
 	/* Read output of the process. */
-	for (;;) {
-		line = get_line(param);
-		if (line == NULL)
-			param->die("unexpected EOF.");
-		if (strcmp(line, TERMINATOR) == 0)
-			break;
-		put_line(line, param);
-	}
+	put_frame(read_frame(param), param);
+	flush_tags(param);
 }
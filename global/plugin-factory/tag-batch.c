@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2026 Tama Communications Corporation
+ *
+ * This file is part of GNU GLOBAL.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#ifdef STDC_HEADERS
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#else
+#include <strings.h>
+#endif
+
+#include "parser.h"
+#include "tag-batch.h"
+
+/*
+ * Tags of the current file (shared by the plug-in parsers).
+ *
+ * The tags are stored until the output for the file ends, and are passed
+ * to gtags at once with param->put_batch. The strings are stored in
+ * 'strpool'; entries keep the offsets because the pool may move.
+ */
+#define INITIAL_POOLSIZE	1024
+
+struct entry {
+	int type;
+	size_t tag;			/**< offset of tag name in strpool */
+	int lineno;
+	size_t image;			/**< offset of line image in strpool */
+};
+static struct entry *entries;
+static int entry_count, entry_size;
+static char *strpool;
+static size_t strpool_used, strpool_size;
+static struct parser_tag *tags;
+static int tag_size;
+
+static size_t
+save_string(const char *s, size_t len, const struct parser_param *param)
+{
+	size_t offset = strpool_used;
+
+	if (strpool_used + len + 1 > strpool_size) {
+		while (strpool_used + len + 1 > strpool_size)
+			strpool_size = strpool_size ? strpool_size * 2 : INITIAL_POOLSIZE;
+		strpool = realloc(strpool, strpool_size);
+		if (strpool == NULL)
+			param->die("short of memory.");
+	}
+	memcpy(strpool + offset, s, len);
+	strpool[offset + len] = '\0';
+	strpool_used += len + 1;
+	return offset;
+}
+/**
+ * add_tag: store a tag of the current file.
+ *
+ *	@param[in]	type	PARSER_DEF or PARSER_REF_SYM
+ *	@param[in]	tag	tag name (need not be terminated by '\0')
+ *	@param[in]	taglen	length of tag name
+ *	@param[in]	lineno	line number
+ *	@param[in]	image	line image (need not be terminated by '\0')
+ *	@param[in]	imagelen length of line image
+ *	@param[in]	param	parser parameter
+ */
+void
+add_tag(int type, const char *tag, size_t taglen, int lineno, const char *image, size_t imagelen, const struct parser_param *param)
+{
+	struct entry *e;
+
+	if (entry_count >= entry_size) {
+		entry_size = entry_size ? entry_size * 2 : 256;
+		entries = realloc(entries, entry_size * sizeof(struct entry));
+		if (entries == NULL)
+			param->die("short of memory.");
+	}
+	e = &entries[entry_count++];
+	e->type = type;
+	e->tag = save_string(tag, taglen, param);
+	e->lineno = lineno;
+	e->image = save_string(image, imagelen, param);
+}
+/**
+ * flush_tags: pass the stored tags to gtags, and forget them.
+ *
+ *	@param[in]	param	parser parameter
+ *
+ * Hosts which do not have put_batch get the tags one by one with put.
+ */
+void
+flush_tags(const struct parser_param *param)
+{
+	int i;
+
+	if (entry_count > tag_size) {
+		tag_size = entry_size;
+		tags = realloc(tags, tag_size * sizeof(struct parser_tag));
+		if (tags == NULL)
+			param->die("short of memory.");
+	}
+	for (i = 0; i < entry_count; i++) {
+		tags[i].type = entries[i].type;
+		tags[i].tag = strpool + entries[i].tag;
+		tags[i].lineno = entries[i].lineno;
+		tags[i].image = strpool + entries[i].image;
+	}
+	if (PARSER_PARAM_HAS(param, put_batch)) {
+		if (entry_count > 0)
+			param->put_batch(tags, entry_count, param->file, param->arg);
+	} else {
+		for (i = 0; i < entry_count; i++)
+			param->put(tags[i].type, tags[i].tag, tags[i].lineno, param->file, tags[i].image, param->arg);
+	}
+	entry_count = 0;
+	strpool_used = 0;
+}
@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2026 Tama Communications Corporation
+ *
+ * This file is part of GNU GLOBAL.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _TAG_BATCH_H_
+#define _TAG_BATCH_H_
+
+#include <stddef.h>
+#include "parser.h"
+
+void add_tag(int, const char *, size_t, int, const char *, size_t, const struct parser_param *);
+void flush_tags(const struct parser_param *);
+
+#endif /* ! _TAG_BATCH_H_ */